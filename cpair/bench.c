@@ -0,0 +1,118 @@
+/**
+ * @file bench.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief Runs one cpair invocation and reports how expensive it was.
+ * @details Prints one row with the wall time, the peak resident set size of the largest process
+ * in the tree, the amount of processes created while it ran and the points handled per second.
+ * The process count comes from the system wide fork counter in /proc/stat, so it is only
+ * accurate on an otherwise quiet machine.
+ **/
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/wait.h"
+#include "sys/time.h"
+#include "sys/resource.h"
+
+/**
+ * @brief Print a usage message to stderr and exit the process with EXIT_FAILURE.
+ * @param process The name of the current process.
+ */
+void usage(const char *process) {
+    fprintf(stderr, "[%s] USAGE: %s ENGINE DATASET COUNT FILE COMMAND [ARGUMENT...]\n", process, process);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Reads the amount of processes created since boot.
+ * @return The counter or -1 if it is not available.
+ */
+long long forkcounter(void) {
+    FILE *stat = fopen("/proc/stat", "r");
+    if (stat == NULL) {
+        return -1;
+    }
+
+    long long processes = -1;
+    char *line = NULL;
+    size_t linelen = 0;
+    while (getline(&line, &linelen, stat) != -1) {
+        if (sscanf(line, "processes %lld", &processes) == 1) {
+            break;
+        }
+    }
+
+    free(line);
+    fclose(stat);
+    return processes;
+}
+
+/**
+ * @brief The entrypoint of the program.
+ * @param argc
+ * @param argv
+ * @return The exit status of the benchmarked command, EXIT_FAILURE if it could not be run.
+ */
+int main(int argc, char *argv[]) {
+    const char *process = argv[0];
+    if (argc < 6) {
+        usage(process);
+    }
+
+    const char *engine = argv[1];
+    const char *dataset = argv[2];
+    double count = strtod(argv[3], NULL);
+    const char *file = argv[4];
+
+    long long forksBefore = forkcounter();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t child = fork();
+    if (child == -1) {
+        fprintf(stderr, "[%s] ERROR: Cannot fork\n", process);
+        exit(EXIT_FAILURE);
+    }
+
+    if (child == 0) {
+        int input = open(file, O_RDONLY);
+        int output = open("/dev/null", O_WRONLY);
+        if (input == -1 || output == -1 || dup2(input, STDIN_FILENO) == -1 || dup2(output, STDOUT_FILENO) == -1) {
+            fprintf(stderr, "[%s] ERROR: Cannot redirect %s: %s\n", process, file, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        close(input);
+        close(output);
+
+        execvp(argv[5], &argv[5]);
+        fprintf(stderr, "[%s] ERROR: Cannot exec: %s\n", process, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long long forksAfter = forkcounter();
+
+    // Every process of the tree has been waited for, so this holds the largest one of them
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+
+    double wall = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    long long spawned = (forksBefore == -1 || forksAfter == -1) ? -1 : forksAfter - forksBefore;
+    int failed = !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+
+    printf("%-12s %-11s %10.0f %10.3f %12ld %10lld %14.0f%s\n",
+           engine, dataset, count, wall, usage.ru_maxrss, spawned, count / wall, failed ? "  FAILED" : "");
+    fflush(stdout);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
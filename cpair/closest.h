@@ -0,0 +1,127 @@
+/**
+ * @file closest.h
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The closest pair program for one coordinate type.
+ * @details This file has no include guard on purpose, precision.c includes it once per coordinate type
+ * after defining:
+ * - SUFFIX the suffix appended to every function name (double, fixed),
+ * - COORD the type of a coordinate,
+ * - DIST the type of a squared distance, wide enough to hold one without rounding for integer coordinates,
+ * - SUM a type that holds the sum of all coordinates, for the mean,
+ * - DIFFSQ(a, b) the squared difference of two coordinates as a DIST,
+ * - RADIUSSQ(q) the squared radius of a QUERY_RADIUS query as a DIST,
+ * - PARSE(cursor, end, value) scanning the COORD at *cursor and moving the cursor past it, see scanpoints.h,
+ * - PRINT(file, value) printing one coordinate.
+ *
+ * It declares the point types of the coordinate type, instantiates the parser of scanpoints.h
+ * and the engine of engine.h for them and prints the answers. All comparisons are done
+ * on squared distances, no square root is ever taken.
+ **/
+
+#define TYPED(name) TYPEDJOIN(name, SUFFIX)
+#define TYPEDJOIN(name, suffix) TYPEDJOIN2(name, suffix)
+#define TYPEDJOIN2(name, suffix) name##suffix
+
+typedef struct {
+    COORD x;
+    COORD y;
+} TYPED(point);
+
+typedef struct {
+    COORD *x;
+    COORD *y;
+} TYPED(pointsoa);
+
+typedef struct {
+    TYPED(point) pair[2];
+    DIST sq;
+} TYPED(pointpair);
+
+typedef struct {
+    TYPED(pointpair) *pairs;
+    size_t stored;
+    size_t capacity;
+} TYPED(pairset);
+
+/**
+ * @brief Finds the candidate closest to a point, the scalar counterpart of nearest.
+ * @details There has to be at least one candidate.
+ */
+static DIST TYPED(nearest)(COORD px, COORD py, const COORD *x, const COORD *y, size_t count, size_t *index) {
+    DIST best = DIFFSQ(px, x[0]) + DIFFSQ(py, y[0]);
+    *index = 0;
+    for (size_t i = 1; i < count; i++) {
+        DIST distance = DIFFSQ(px, x[i]) + DIFFSQ(py, y[i]);
+        if (distance < best) {
+            best = distance;
+            *index = i;
+        }
+    }
+    return best;
+}
+
+#define ENGINE static
+#define NEAREST(px, py, x, y, count, index) TYPED(nearest)(px, py, x, y, count, index)
+#include "engine.h"
+#undef ENGINE
+#undef NEAREST
+
+#define SCANPOINTS TYPED(parsepoints)
+#define SCANPOINT TYPED(point)
+#include "scanpoints.h"
+#undef SCANPOINTS
+#undef SCANPOINT
+
+/**
+ * @brief Prints a pair in the same order as printpairsorted.
+ */
+static void TYPED(printpair)(FILE *file, TYPED(point) pair[2], const char *process) {
+    int swapped = pair[1].x < pair[0].x || (pair[1].x == pair[0].x && pair[1].y < pair[0].y);
+    for (int i = 0; i < 2; i++) {
+        TYPED(point) p = pair[swapped ? 1 - i : i];
+        PRINT(file, p.x);
+        fputc(' ', file);
+        PRINT(file, p.y);
+        if (fputc('\n', file) == EOF) {
+            error("Error writing to file", process);
+        }
+    }
+}
+
+/**
+ * @brief Reads text points from fd and prints their closest pair, or the pairs of a query, to output.
+ * @return The amount of points read.
+ */
+static ssize_t TYPED(cpair)(int fd, FILE *output, size_t threads, size_t cutoff, const query *q,
+                            const char *process) {
+    textinput text;
+    TYPED(point) *points;
+    textopen(fd, &text, process);
+    ssize_t stored = TYPED(parsepoints)(text.data, text.size, &points, process);
+    textclose(&text);
+
+    if (q != NULL) {
+        TYPED(pairset) result;
+        TYPED(threadedquery)(points, stored, threads, cutoff, q, &result, process);
+        for (size_t i = 0; i < result.stored; i++) {
+            TYPED(printpair)(output, result.pairs[i].pair, process);
+        }
+        free(result.pairs);
+    } else {
+        TYPED(point) pair[2];
+        if (TYPED(threadedcpair)(points, stored, threads, cutoff, pair, process) == 2) {
+            TYPED(printpair)(output, pair, process);
+        }
+    }
+
+    if (fflush(output) == EOF) {
+        error("Error writing to file", process);
+    }
+    free(points);
+    return stored;
+}
+
+#undef TYPED
+#undef TYPEDJOIN
+#undef TYPEDJOIN2
@@ -13,11 +13,37 @@
 #include "sys/wait.h"
 #include "sys/types.h"
 #include "math.h"
+#include "limits.h"
+#include "stdint.h"
+#include "fcntl.h"
+#include "spawn.h"
+#include "cpair.h"
 
+extern char **environ;
+
+/**
+ * Default size below which the threaded engine stops spawning tasks.
+ */
+#define DEFAULT_CUTOFF (8192)
+
+/**
+ * The options a process of the tree passes on to its children.
+ */
 typedef struct {
-    float x;
-    float y;
-} point;
+    int binary;
+    // Process levels the child may still fork, negative if unbounded
+    long levels;
+    size_t threads;
+    size_t cutoff;
+    int stats;
+    // The trace file, NULL if the tree is not traced
+    const char *trace;
+    long depth;
+    // The shared memory object and the range of the child in it, sharedFd is -1 if points go through the pipe
+    int sharedFd;
+    size_t sharedOffset;
+    size_t sharedStored;
+} childoptions;
 
 /**
  * @brief Print an error message to stderr and exit the process with EXIT_FAILURE.
@@ -33,10 +59,76 @@ void error(char *message, const char *process) {
  * @param process The name of the current process.
  */
 void usage(const char *process) {
-    fprintf(stderr, "[%s] ERROR: %s does not accept any arguments.\n", process, process);
+    fprintf(stderr, "[%s] USAGE: %s [-g | -s | -v | -i INDEX [-n] | -p PRECISION [-t THREADS [-c CUTOFF]] [-k K | -r RADIUS] | -w WORKERS | [-b | -m] [-S] [-T TRACE] [-d DEPTH] [-t THREADS [-c CUTOFF]] [-k K | -r RADIUS]] [FILE]\n", process, process);
     exit(EXIT_FAILURE);
 }
 
+/**
+ * @brief Print that the input held no points and exit the process with EXIT_FAILURE.
+ * @param process The name of the current process.
+ */
+void nopoints(const char *process) {
+    fprintf(stderr, "[%s] ERROR: No points provided via stdin!\n", process);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Parses a positive size from a string.
+ * @param str The string you intend to convert.
+ * @param value &mut The parsed value.
+ * @return 0 if successful -1 otherwise
+ */
+int parsesize(const char *str, size_t *value) {
+    errno = 0;
+    char *endptr;
+    long result = strtol(str, &endptr, 10);
+
+    if (errno != 0 || endptr == str || *endptr != '\0' || result <= 0 || result == LONG_MAX) {
+        return -1;
+    }
+
+    *value = (size_t)result;
+    return 0;
+}
+
+/**
+ * @brief Parses a non-negative amount of levels from a string.
+ * @param str The string you intend to convert.
+ * @param value &mut The parsed value.
+ * @return 0 if successful -1 otherwise
+ */
+int parselevels(const char *str, long *value) {
+    errno = 0;
+    char *endptr;
+    long result = strtol(str, &endptr, 10);
+
+    if (errno != 0 || endptr == str || *endptr != '\0' || result < 0 || result == LONG_MAX) {
+        return -1;
+    }
+
+    *value = result;
+    return 0;
+}
+
+/**
+ * @brief Parses a non-negative float from a string.
+ * @param str The string you intend to convert.
+ * @param value &mut The parsed value.
+ * @return 0 if successful -1 otherwise
+ */
+int parsedistance(const char *str, float *value) {
+    errno = 0;
+    char *endptr;
+    float result = strtof(str, &endptr);
+
+    if (errno != 0 || endptr == str || *endptr != '\0' || !(result >= 0.0f) || isinf(result)) {
+        return -1;
+    }
+
+    *value = result;
+    return 0;
+}
+
 /**
  * @brief Prints a point to a file.
  * @details It is assumed that both parameters are valid.
@@ -48,21 +140,71 @@ int ptofile(FILE *file, point *p) {
 }
 
 /**
- * @brief Returns the mean of the x values of a point array.
- * @details It is assumed that both parameters are valid.
- * @param points The point array you intend to calculate the mean of.
- * @param stored The amount of points in the point array.
- * @param axis The axis along which you intend to sort the points.
- * @details The axis parameter DOES NOT check for the validity of the input character.
- * It is highly advised that you double check it when using this function.
+ * @brief Returns the coordinate of a point along an axis.
  */
-float meanpx(point *points, size_t stored, char axis) {
-    float sum = 0.0f;
-    for (size_t i = 0; i < stored; i++) {
-        sum += (axis == 'x') ? points[i].x : points[i].y;
+float coordinate(point p, char axis) {
+    return (axis == 'x') ? p.x : p.y;
+}
+
+/**
+ * @brief Moves the median of a point array along an axis to position stored / 2 (nth_element).
+ * @details Points before that position have coordinates <= the median, points after it >= the median,
+ * so splitting at stored / 2 always gives two halves of (almost) the same size, whatever the distribution.
+ * Runs in expected linear time.
+ * @param points &mut The point array, it gets reordered.
+ * @param stored The amount of points in the point array, at least 1.
+ * @param axis The axis along which you intend to split the points.
+ * @return The median coordinate, the position of the split line.
+ */
+float medianpx(point *points, size_t stored, char axis) {
+    size_t middle = stored / 2;
+    size_t from = 0;
+    size_t to = stored;
+
+    while (to - from > 1) {
+        float pivot = coordinate(points[from + (to - from) / 2], axis);
+        size_t i = from;
+        size_t lt = from;
+        size_t gt = to;
+
+        // Three way partition into < pivot, == pivot and > pivot, so duplicates cannot stall it
+        while (i < gt) {
+            float c = coordinate(points[i], axis);
+            if (c < pivot) {
+                point tmp = points[lt];
+                points[lt++] = points[i];
+                points[i++] = tmp;
+            } else if (c > pivot) {
+                point tmp = points[--gt];
+                points[gt] = points[i];
+                points[i] = tmp;
+            } else {
+                i++;
+            }
+        }
+
+        if (middle < lt) {
+            to = lt;
+        } else if (middle >= gt) {
+            from = gt;
+        } else {
+            break;
+        }
     }
-    sum /= (float)stored;
-    return (float)sum;
+
+    return coordinate(points[middle], axis);
+}
+
+/**
+ * @brief Prints the statistics line of one process of the tree to stderr.
+ * @param process The name of the current process.
+ * @param depth The depth of the process, 0 for the root.
+ * @param stored The amount of points the process got.
+ * @param left The amount of points sent to the left child, 0 for leaves.
+ * @param right The amount of points sent to the right child, 0 for leaves.
+ */
+void printstats(const char *process, long depth, size_t stored, size_t left, size_t right) {
+    fprintf(stderr, "[%s] STATS: depth %ld points %zu left %zu right %zu\n", process, depth, stored, left, right);
 }
 
 /**
@@ -119,48 +261,13 @@ void closepipes(int rightReadPipe[2], int leftReadPipe[2], int rightWritePipe[2]
 
 /**
  * @brief Converts standard in to a point array.
- * @details Dynamically allocates memory to store the points.
+ * @details Dynamically allocates memory to store the points, see loadpoints.
  * @param points &mut A pointer to an UNINITIALISED point array.
  * @param process The name of the current process.
- * @return A signed size that indicates the size of the array
- * -1 if it was unable to allocate memory.
+ * @return A signed size that indicates the size of the array.
  */
-ssize_t stdintopa(point **points, const char *process)
-{
-    ssize_t stored = 0;
-    size_t capacity = 2;
-    *points = malloc(sizeof(point) * capacity);
-
-    if (points == NULL)
-    {
-        error("Failed to allocate memory", process);
-    }
-
-    char *line = NULL;
-    size_t linelen = 0;
-    while (getline(&line, &linelen, stdin) != -1)
-    {
-        // Resize
-        if (capacity == stored)
-        {
-            capacity *= 2;
-            point *tmp = realloc(*points, sizeof(point) * capacity);
-            if (tmp == NULL)
-            {
-                free(line);
-                free(*points);
-                error("Failed to allocate memory", process);
-            }
-            *points = tmp;
-        }
-
-        point p = strtop(line, process);
-        (*points)[stored] = p;
-        stored++;
-    }
-
-    free(line);
-    return stored;
+ssize_t stdintopa(point **points, const char *process) {
+    return loadpoints(STDIN_FILENO, points, process);
 }
 
 /**
@@ -184,6 +291,122 @@ size_t ctop(FILE *file, point points[2], const char *process) {
     return stored;
 }
 
+/**
+ * @brief Writes a whole buffer to a file descriptor, retrying on partial writes.
+ * @param fd The file descriptor you intend to write to.
+ * @param buffer The bytes you intend to write.
+ * @param size The amount of bytes in the buffer.
+ * @return 0 if successful -1 otherwise
+ */
+int writeall(int fd, const void *buffer, size_t size) {
+    const char *bytes = buffer;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads exactly size bytes from a file descriptor, retrying on partial reads.
+ * @param fd The file descriptor you intend to read from.
+ * @param buffer &mut The buffer you intend to fill.
+ * @param size The amount of bytes you intend to read.
+ * @return The amount of bytes read, which is less than size only at EOF, or -1 on error.
+ */
+ssize_t readall(int fd, void *buffer, size_t size) {
+    char *bytes = buffer;
+    size_t total = 0;
+    while (total < size) {
+        ssize_t got = read(fd, bytes + total, size - total);
+        if (got == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        total += (size_t)got;
+    }
+    return (ssize_t)total;
+}
+
+/**
+ * @brief Writes a point array to a file descriptor in the binary wire format.
+ * @details The format is a uint64_t holding the amount of points followed by the raw point structs.
+ * @param fd The file descriptor you intend to write to.
+ * @param points The points you intend to write.
+ * @param stored The amount of points in the point array.
+ * @return 0 if successful -1 otherwise
+ */
+int patofd(int fd, point *points, size_t stored) {
+    uint64_t header = stored;
+    if (writeall(fd, &header, sizeof(header)) == -1) {
+        return -1;
+    }
+    return writeall(fd, points, sizeof(point) * stored);
+}
+
+/**
+ * @brief Reads a point array in the binary wire format from a file descriptor.
+ * @details Dynamically allocates memory to store the points. A stream that ends before the header counts as empty.
+ * @param fd The file descriptor you intend to read from.
+ * @param points &mut A pointer to an UNINITIALISED point array.
+ * @param process The name of the current process.
+ * @return The amount of points read.
+ */
+ssize_t fdtopa(int fd, point **points, const char *process) {
+    uint64_t header = 0;
+    ssize_t got = readall(fd, &header, sizeof(header));
+
+    if (got == -1 || (got != 0 && got != sizeof(header)) || header > SSIZE_MAX / sizeof(point)) {
+        error("Malformed binary input", process);
+    }
+
+    *points = malloc(sizeof(point) * (header > 0 ? header : 1));
+    if (*points == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    size_t size = sizeof(point) * header;
+    if (readall(fd, *points, size) != (ssize_t)size) {
+        free(*points);
+        error("Malformed binary input", process);
+    }
+    return (ssize_t)header;
+}
+
+/**
+ * @brief Converts binary child output to an array of (max) 2 points.
+ * @param fd The file descriptor to which the child has written its output.
+ * @param points &mut An INITIALISED array of 2 points.
+ * @param process The name of the current process.
+ * @return An unsigned size that indicates the amount of points written.
+ */
+size_t ctopbinary(int fd, point points[2], const char *process) {
+    uint64_t header = 0;
+    ssize_t got = readall(fd, &header, sizeof(header));
+
+    if (got == 0) {
+        return 0;
+    }
+
+    if (got != sizeof(header) || header > 2 ||
+        readall(fd, points, sizeof(point) * header) != (ssize_t)(sizeof(point) * header)) {
+        error("Malformed binary input", process);
+    }
+    return (size_t)header;
+}
+
 /**
  * @brief A function that calculates the euclidean distance of 2 points.
  * @param p1 Point one
@@ -191,7 +414,20 @@ size_t ctop(FILE *file, point points[2], const char *process) {
  * @return The euclidean distance of of the aforementioned points.
  */
 float euclidean(point p1, point p2) {
-    return sqrtf((float)(pow(p2.x - p1.x, 2) + pow(p2.y - p1.y, 2)));
+    return sqrtf(sqdistance(p1, p2));
+}
+
+/**
+ * @brief A function that calculates the squared euclidean distance of 2 points.
+ * @details Orders pairs the same way as euclidean, without the square root.
+ * @param p1 Point one
+ * @param p2 Point two
+ * @return The squared euclidean distance of the aforementioned points.
+ */
+float sqdistance(point p1, point p2) {
+    float dx = p2.x - p1.x;
+    float dy = p2.y - p1.y;
+    return dx * dx + dy * dy;
 }
 
 /**
@@ -228,24 +464,155 @@ void printpairsorted(FILE *file, point pair[2], const char *process) {
 
 /**
  * @brief Sends points to 2 child processes.
- * @param points The points you intend to send to a child process.
+ * @param points The points you intend to send to a child process, already split by medianpx.
  * @param stored The number of points stored in the points array.
- * @param axis The axis along which you intend to split the points in two.
+ * @param storedLeft The number of points that go to the left child, the rest goes to the right one.
  * @param leftWriteFile The file descriptor of the left child.
  * @param rightWriteFile The file descriptor of the right child.
  */
-void ptoc(point *points, ssize_t stored, char axis, FILE *leftWriteFile, FILE *rightWriteFile) {
-    float mean = meanpx(points, stored, axis);
+void ptoc(point *points, size_t stored, size_t storedLeft, FILE *leftWriteFile, FILE *rightWriteFile) {
+    for (size_t i = 0; i < stored; i++) {
+        ptofile((i < storedLeft) ? leftWriteFile : rightWriteFile, &points[i]);
+    }
+}
 
-    for (int i = 0; i < stored; i++) {
-        if ((axis == 'x' && points[i].x <= mean) || (axis == 'y' && points[i].y <= mean)) {
-            ptofile(leftWriteFile, &points[i]);
-        } else {
-            ptofile(rightWriteFile, &points[i]);
+/**
+ * @brief Sends points to 2 child processes using the binary wire format.
+ * @details Both halves are contiguous after medianpx, so each child receives its points with a single write.
+ * @param points The points you intend to send to a child process, already split by medianpx.
+ * @param stored The number of points stored in the points array.
+ * @param storedLeft The number of points that go to the left child, the rest goes to the right one.
+ * @param leftFd The file descriptor of the left child.
+ * @param rightFd The file descriptor of the right child.
+ * @return 0 if successful -1 otherwise
+ */
+int ptocbinary(point *points, size_t stored, size_t storedLeft, int leftFd, int rightFd) {
+    if (patofd(leftFd, points, storedLeft) == -1 ||
+        patofd(rightFd, points + storedLeft, stored - storedLeft) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes the result of this process to stdout.
+ * @param pair An array of 2 points or NULL if there is no pair.
+ * @param binary Whether stdout is a pipe to a parent speaking the binary wire format.
+ * @param process The name of the current process.
+ */
+void outputpair(point pair[2], int binary, const char *process) {
+    if (binary) {
+        if (patofd(STDOUT_FILENO, pair, (pair == NULL) ? 0 : 2) == -1) {
+            error("Error writing to file", process);
         }
+        return;
+    }
+
+    if (pair != NULL) {
+        printpairsorted(stdout, pair, process);
+        fflush(stdout);
     }
 }
 
+/**
+ * @brief Creates a pipe whose ends are closed on exec.
+ * @details Spawned children only keep the ends that get duplicated onto their stdin and stdout,
+ * so they never hold on to the pipes of their siblings.
+ * @param fds &mut The read end and the write end, like pipe.
+ * @return 0 if successful -1 otherwise
+ */
+int pipecloexec(int fds[2]) {
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+    if (fcntl(fds[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    return 0;
+}
+
+pid_t spawnpiped(char *const args[], int input, int output) {
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0) {
+        return -1;
+    }
+
+    pid_t pid = -1;
+    int result = posix_spawn_file_actions_adddup2(&actions, input, STDIN_FILENO);
+    if (result == 0) {
+        result = posix_spawn_file_actions_adddup2(&actions, output, STDOUT_FILENO);
+    }
+    if (result == 0) {
+        result = posix_spawnp(&pid, args[0], &actions, NULL, args, environ);
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    if (result != 0) {
+        errno = result;
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * @brief Starts a cpair process solving one half of the points.
+ * @param process The name of the current process.
+ * @param options The options the child gets started with.
+ * @param input The pipe end that becomes stdin of the child.
+ * @param output The pipe end that becomes stdout of the child.
+ * @return The pid of the child, -1 if it could not be started.
+ */
+pid_t spawnchild(const char *process, const childoptions *options, int input, int output) {
+    char levelsArg[32];
+    char threadsArg[32];
+    char cutoffArg[32];
+    char depthArg[32];
+    char sharedArg[96];
+    char *args[18];
+    size_t count = 0;
+
+    args[count++] = (char *)process;
+    if (options->binary) {
+        args[count++] = "-B";
+    }
+    if (options->levels >= 0) {
+        snprintf(levelsArg, sizeof(levelsArg), "%ld", options->levels);
+        args[count++] = "-d";
+        args[count++] = levelsArg;
+    }
+    if (options->threads != 0) {
+        snprintf(threadsArg, sizeof(threadsArg), "%zu", options->threads);
+        snprintf(cutoffArg, sizeof(cutoffArg), "%zu", options->cutoff);
+        args[count++] = "-t";
+        args[count++] = threadsArg;
+        args[count++] = "-c";
+        args[count++] = cutoffArg;
+    }
+    if (options->stats) {
+        args[count++] = "-S";
+    }
+    if (options->trace != NULL) {
+        args[count++] = "-T";
+        args[count++] = (char *)options->trace;
+    }
+    if (options->sharedFd != -1) {
+        snprintf(sharedArg, sizeof(sharedArg), "%d:%zu:%zu", options->sharedFd, options->sharedOffset,
+                 options->sharedStored);
+        args[count++] = "-M";
+        args[count++] = sharedArg;
+    }
+    if (options->stats || options->trace != NULL) {
+        snprintf(depthArg, sizeof(depthArg), "%ld", options->depth);
+        args[count++] = "-L";
+        args[count++] = depthArg;
+    }
+    args[count] = NULL;
+
+    return spawnpiped(args, input, output);
+}
+
 /**
  * @brief Counts the number of coordinates that are identical*.
  * @details The function does not count ALL identical coordinates.
@@ -268,45 +635,106 @@ int countcoordinates(point *points, ssize_t stored, char axis) {
     return count;
 }
 
+/**
+ * @brief Orders points by their y coordinate (and x on ties), for use with qsort.
+ */
+int comparey(const void *a, const void *b) {
+    const point *p1 = a;
+    const point *p2 = b;
+
+    if (p1->y != p2->y) {
+        return (p1->y < p2->y) ? -1 : 1;
+    }
+    if (p1->x != p2->x) {
+        return (p1->x < p2->x) ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copies the points that lie closer than delta to the split line into the strip.
+ * @details Keeps the order of the points, so a y-sorted input gives a y-sorted strip.
+ * @param points The array of points of the upper sub problem.
+ * @param stored The amount of points stored in the points array.
+ * @param mean The position of the split line.
+ * @param bestSq The squared distance of the best pair found so far.
+ * @param axis The axis along which the points were split.
+ * @param strip &mut An array with room for stored points.
+ * @return The amount of points in the strip.
+ */
+size_t filterstrip(point *points, size_t stored, float mean, float bestSq, char axis, point *strip) {
+    size_t storedStrip = 0;
+    for (size_t i = 0; i < stored; i++) {
+        float offset = ((axis == 'x') ? points[i].x : points[i].y) - mean;
+        if (offset * offset < bestSq) {
+            strip[storedStrip] = points[i];
+            storedStrip++;
+        }
+    }
+    return storedStrip;
+}
+
+/**
+ * @brief Looks for a pair closer than mergedChildren inside a strip sorted by y.
+ * @details Every point is only compared to the following points that are less than delta
+ * above it, which are at most a constant amount because each side holds no pair closer than delta.
+ * Distances stay squared, the candidates of each point are handed to the nearest kernel as one block.
+ * @param x The x coordinates of the points around the split line, sorted by y.
+ * @param y The y coordinates of the points around the split line, sorted by y.
+ * @param stored The amount of points in the strip.
+ * @param mergedChildren &mut Initially the better pair of the two sub problems.
+ */
+void mergestrip(const float *x, const float *y, size_t stored, point mergedChildren[2]) {
+    float bestSq = sqdistance(mergedChildren[0], mergedChildren[1]);
+
+    for (size_t i = 0; i + 1 < stored; i++) {
+        size_t end = i + 1;
+        while (end < stored && (y[end] - y[i]) * (y[end] - y[i]) < bestSq) {
+            end++;
+        }
+
+        size_t index;
+        float distance = nearest(x[i], y[i], x + i + 1, y + i + 1, end - i - 1, &index);
+        if (distance < bestSq) {
+            bestSq = distance;
+            mergedChildren[0] = (point){x[i], y[i]};
+            mergedChildren[1] = (point){x[i + 1 + index], y[i + 1 + index]};
+        }
+    }
+}
+
 /**
  * @brief Finds the closest points from the two sub problems.
+ * @details Sorts the points around the split line by y and merges them with mergestrip.
  * @param points The array of points of the upper sub problem.
  * @param stored The amount of points stored in the points array.
  * @param mergedChildren &mut Initially an array of points of the better pair of the two sub problems.
- * @param mean The mean of the points array.
+ * @param mean The position of the split line.
  * @param axis The axis along which you intend to merge the points.
+ * @param process The name of the current process.
  */
-void mergefinal(point *points, ssize_t stored, point mergedChildren[2], float mean, char axis) {
+void mergefinal(point *points, ssize_t stored, point mergedChildren[2], float mean, char axis, const char *process) {
+    float bestSq = sqdistance(mergedChildren[0], mergedChildren[1]);
+    size_t capacity = (stored > 0) ? (size_t)stored : 1;
+    point *strip = malloc(sizeof(point) * capacity);
+    float *coordinates = malloc(sizeof(float) * 2 * capacity);
 
-    float delta = euclidean(mergedChildren[0], mergedChildren[1]);
-    int storedLeftSide = 0;
-    point leftSide[stored];
-
-    for (ssize_t i = 0; i < stored; ++i) {
-        // Check if point is on the left side and within the delta region based on the specified axis
-        if ((axis == 'x' && points[i].x < mean && (points[i].x + delta) > mean) ||
-            (axis == 'y' && points[i].y < mean && (points[i].y + delta) > mean)) {
-            leftSide[storedLeftSide] = points[i];
-            storedLeftSide += 1;
-        }
+    if (strip == NULL || coordinates == NULL) {
+        error("Failed to allocate memory", process);
     }
 
-    for (ssize_t j = 0; j < stored; ++j) {
-        if ((axis == 'x' && points[j].x < mean) || (axis == 'y' && points[j].y < mean) ||
-            (axis == 'x' && points[j].x - mean > delta) || (axis == 'y' && points[j].y - mean > delta)) {
-            // Skip all irrelevant points based on the specified axis
-            continue;
-        }
+    size_t storedStrip = filterstrip(points, stored, mean, bestSq, axis, strip);
+    qsort(strip, storedStrip, sizeof(point), comparey);
 
-        for (int k = 0; k < storedLeftSide; ++k) {
-            float delta2 = euclidean(points[j], leftSide[k]);
-            if (delta2 < delta) {
-                delta = delta2;
-                mergedChildren[0] = points[j];
-                mergedChildren[1] = leftSide[k];
-            }
-        }
+    pointsoa soa = {.x = coordinates, .y = coordinates + capacity};
+    for (size_t i = 0; i < storedStrip; i++) {
+        soa.x[i] = strip[i].x;
+        soa.y[i] = strip[i].y;
     }
+    mergestrip(soa.x, soa.y, storedStrip, mergedChildren);
+
+    free(coordinates);
+    free(strip);
 }
 
 /**
@@ -337,8 +765,8 @@ int mergechildren(point child1Points[2], size_t a, point child2Points[2], size_t
         return 0;
     }
 
-    if (euclidean(child1Points[0], child1Points[1]) <=
-        euclidean(child2Points[0], child2Points[1]))
+    if (sqdistance(child1Points[0], child1Points[1]) <=
+        sqdistance(child2Points[0], child2Points[1]))
     {
         mergedChildren[0] = child1Points[0];
         mergedChildren[1] = child1Points[1];
@@ -350,6 +778,50 @@ int mergechildren(point child1Points[2], size_t a, point child2Points[2], size_t
     }
 }
 
+/**
+ * @brief Inserts the points into a persistent index and prints its closest pair,
+ * or prints the nearest indexed point of every point.
+ * @param path The path of the index file.
+ * @param probe Whether the points are probes instead of new points.
+ * @param points &mut The points read from the input.
+ * @param stored The amount of points in the point array.
+ * @param process The name of the current process.
+ * @return EXIT_SUCCESS if everything worked fine else EXIT_FAILURE
+ */
+int runindex(const char *path, int probe, point *points, size_t stored, const char *process) {
+    kdindex index;
+    if (kdopen(&index, path, !probe, process) == -1) {
+        return EXIT_FAILURE;
+    }
+
+    if (probe) {
+        point *results = malloc(sizeof(point) * (stored > 0 ? stored : 1));
+        if (results == NULL) {
+            error("Failed to allocate memory", process);
+        }
+
+        int result = kdnearest(&index, points, stored, results, process);
+        for (size_t i = 0; result == 0 && i < stored; i++) {
+            if (ptofile(stdout, &results[i]) < 0) {
+                error("Error writing to file", process);
+            }
+        }
+
+        free(results);
+        kdclose(&index);
+        return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    kdinsert(&index, points, stored, process);
+
+    point pair[2];
+    if (kdclosest(&index, pair) == 2) {
+        printpairsorted(stdout, pair, process);
+    }
+    kdclose(&index);
+    return EXIT_SUCCESS;
+}
+
 /**
  * @brief The entrypoint of the program.
  * @param argc
@@ -359,32 +831,264 @@ int mergechildren(point child1Points[2], size_t a, point child2Points[2], size_t
 int main(int argc, char *argv[]) {
 
     const char *process = argv[0];
-    if (argc != 1) {
+    size_t threads = 0;
+    size_t cutoff = DEFAULT_CUTOFF;
+    int cutoffSet = 0;
+    // -b makes this process talk binary to its children, -B additionally to its parent
+    int binaryChildren = 0;
+    int binaryParent = 0;
+    // -k and -r ask for several pairs instead of only the closest one
+    query q;
+    int querySet = 0;
+    int grid = 0;
+    // -i keeps the points in a persistent index, -n only looks up nearest neighbours in it
+    const char *indexPath = NULL;
+    int probe = 0;
+    int streaming = 0;
+    precision type = PRECISION_FLOAT;
+    int precisionSet = 0;
+    int vectors = 0;
+    // -d bounds how many levels of the recursion are processes, the leaves solve their half in-process
+    long levels = -1;
+    // -S prints one statistics line per process, -T records a trace of all of them,
+    // children learn their depth through the internal -L
+    int stats = 0;
+    const char *tracePath = NULL;
+    long depth = 0;
+    // -w solves the subproblems on a pool of long lived worker processes, which run with the internal -W
+    size_t workers = 0;
+    int worker = 0;
+    // -m hands the points to the children through shared memory, children get their range with the internal -M
+    int shared = 0;
+    const char *sharedRange = NULL;
+    int sharedFd = -1;
+
+    int option;
+    while ((option = getopt(argc, argv, "t:c:bBk:r:gi:nsp:d:vSL:T:w:WmM:")) != -1) {
+        switch (option) {
+            case 'S':
+                stats = 1;
+                break;
+            case 'w':
+                if (workers != 0 || parsesize(optarg, &workers) == -1) {
+                    usage(process);
+                }
+                break;
+            case 'W':
+                worker = 1;
+                break;
+            case 'm':
+                shared = 1;
+                binaryChildren = 1;
+                break;
+            case 'M':
+                sharedRange = optarg;
+                shared = 1;
+                break;
+            case 'T':
+                if (tracePath != NULL) {
+                    usage(process);
+                }
+                tracePath = optarg;
+                break;
+            case 'L':
+                if (parselevels(optarg, &depth) == -1) {
+                    usage(process);
+                }
+                break;
+            case 'v':
+                vectors = 1;
+                break;
+            case 'd':
+                if (levels >= 0 || parselevels(optarg, &levels) == -1) {
+                    usage(process);
+                }
+                break;
+            case 'p':
+                if (precisionSet || parseprecision(optarg, &type) == -1) {
+                    usage(process);
+                }
+                precisionSet = 1;
+                break;
+            case 's':
+                streaming = 1;
+                break;
+            case 'i':
+                if (indexPath != NULL) {
+                    usage(process);
+                }
+                indexPath = optarg;
+                break;
+            case 'n':
+                probe = 1;
+                break;
+            case 'g':
+                grid = 1;
+                break;
+            case 'k':
+                if (querySet || parsesize(optarg, &q.k) == -1) {
+                    usage(process);
+                }
+                q.mode = QUERY_KCLOSEST;
+                querySet = 1;
+                break;
+            case 'r': {
+                float radius;
+                if (querySet || parsedistance(optarg, &radius) == -1) {
+                    usage(process);
+                }
+                q.mode = QUERY_RADIUS;
+                q.radiusSq = radius * radius;
+                q.radius = strtod(optarg, NULL);
+                querySet = 1;
+                break;
+            }
+            case 'B':
+                binaryParent = 1;
+                binaryChildren = 1;
+                break;
+            case 'b':
+                binaryChildren = 1;
+                break;
+            case 't':
+                if (threads != 0 || parsesize(optarg, &threads) == -1) {
+                    usage(process);
+                }
+                break;
+            case 'c':
+                if (cutoffSet || parsesize(optarg, &cutoff) == -1) {
+                    usage(process);
+                }
+                cutoffSet = 1;
+                break;
+            default:
+                usage(process);
+        }
+    }
+
+    // float is the coordinate type of every other mode, so -p float changes nothing
+    if (precisionSet && type == PRECISION_FLOAT) {
+        precisionSet = 0;
+    }
+
+    int bounded = (levels >= 0);
+    if (argc - optind > 1 || (cutoffSet && threads == 0) ||
+        (binaryChildren && ((threads != 0 && !bounded) || querySet)) || (bounded && querySet) ||
+        (grid && (binaryChildren || threads != 0 || querySet)) ||
+        (indexPath != NULL && (grid || binaryChildren || threads != 0 || querySet)) || (probe && indexPath == NULL) ||
+        (streaming && (indexPath != NULL || grid || binaryChildren || threads != 0 || querySet)) ||
+        (precisionSet && (streaming || indexPath != NULL || grid || binaryChildren)) ||
+        (bounded && (streaming || precisionSet || indexPath != NULL || grid)) ||
+        (workers != 0 && (bounded || stats || tracePath != NULL || streaming || precisionSet || vectors ||
+                          indexPath != NULL || grid || binaryChildren || threads != 0 || querySet)) ||
+        (worker && (argc != 2 || optind != argc)) ||
+        (shared && (workers != 0 || streaming || precisionSet || vectors || indexPath != NULL || grid || querySet)) ||
+        (sharedRange != NULL && (!binaryParent || optind != argc)) ||
+        ((stats || tracePath != NULL) && (streaming || precisionSet || vectors || indexPath != NULL || grid || querySet ||
+                   (threads != 0 && !bounded))) ||
+        (vectors && (bounded || streaming || precisionSet || indexPath != NULL || grid || binaryChildren ||
+                     threads != 0 || querySet)) ||
+        (binaryParent && optind != argc)) {
         usage(process);
     }
 
+    if (worker) {
+        exit((workerloop(process) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (precisionSet) {
+        int fd = (optind < argc) ? openinput(argv[optind], process) : STDIN_FILENO;
+        ssize_t stored = precisecpair(type, fd, stdout, (threads == 0) ? 1 : threads, cutoff, querySet ? &q : NULL,
+                                      process);
+        if (fd != STDIN_FILENO) {
+            close(fd);
+        }
+        if (stored == 0) {
+            nopoints(process);
+        }
+        exit(EXIT_SUCCESS);
+    }
+
+    if (streaming || vectors) {
+        FILE *input = stdin;
+        if (optind < argc && (input = fopen(argv[optind], "r")) == NULL) {
+            fprintf(stderr, "[%s] ERROR: Cannot open %s: %s\n", process, argv[optind], strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        int result;
+        if (streaming) {
+            result = streamcpair(input, stdout, process);
+        } else {
+            result = vectorcpair(input, stdout, process);
+        }
+        fclose(input);
+        exit((result == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (tracePath != NULL) {
+        traceopen(tracePath, depth, process);
+    }
+
+    double phase = tracetime();
     point *points;
-    ssize_t stored = stdintopa(&points, process);
+    ssize_t stored;
+    if (sharedRange != NULL) {
+        stored = sharedopen(sharedRange, &points, &sharedFd, process);
+    } else if (binaryParent) {
+        stored = fdtopa(STDIN_FILENO, &points, process);
+    } else if (optind < argc) {
+        stored = filetopa(argv[optind], &points, process);
+    } else {
+        stored = stdintopa(&points, process);
+    }
+    tracepoints((stored > 0) ? (size_t)stored : 0);
+    traceevent("parse", phase);
+
+    if (indexPath != NULL) {
+        int result = runindex(indexPath, probe, points, stored, process);
+        releasepoints(points);
+        exit(result);
+    }
 
     switch (stored) {
         case 0:
-            fprintf(stderr, "[%s] ERROR: No points provided via stdin!\n", process);
-            free(points);
-            exit(EXIT_FAILURE);
+            releasepoints(points);
+            nopoints(process);
             break;
         case 1:
-            free(points);
+            if (stats) {
+                printstats(process, depth, stored, 0, 0);
+            }
+            outputpair(NULL, binaryParent, process);
+            releasepoints(points);
             exit(EXIT_SUCCESS);
             break;
         case 2:
-            printpairsorted(stdout, points, process);
-            fflush(stdout);
-            free(points);
+            if (querySet) {
+                break;
+            }
+            if (stats) {
+                printstats(process, depth, stored, 0, 0);
+            }
+            outputpair(points, binaryParent, process);
+            releasepoints(points);
             exit(EXIT_SUCCESS);
         default:
             break;
     }
 
+    // Queries for several pairs always run in-process
+    if (querySet) {
+        pairset result;
+        threadedquery(points, stored, (threads == 0) ? 1 : threads, cutoff, &q, &result, process);
+        for (size_t i = 0; i < result.stored; i++) {
+            printpairsorted(stdout, result.pairs[i].pair, process);
+        }
+        free(result.pairs);
+        releasepoints(points);
+        exit(EXIT_SUCCESS);
+    }
+
     int sameX = countcoordinates(points, stored, 'x');
     int sameY = countcoordinates(points, stored, 'y');
     point samePoints[2];
@@ -393,11 +1097,60 @@ int main(int argc, char *argv[]) {
     if (sameX == stored && sameY == stored) {
         samePoints[0] = points[0];
         samePoints[1] = points[1];
-        printpairsorted(stdout, samePoints, process);
-        free(points);
+        if (stats) {
+            printstats(process, depth, stored, 0, 0);
+        }
+        outputpair(samePoints, binaryParent, process);
+        releasepoints(points);
         exit(EXIT_SUCCESS);
     }
 
+    // Without -d, -t solves everything in-process, with it only the leaves of the process tree do
+    if ((threads != 0 && !bounded) || grid || levels == 0 || workers != 0) {
+        phase = tracetime();
+        point pair[2];
+        size_t found;
+        if (grid) {
+            found = gridcpair(points, stored, pair, process);
+        } else if (workers != 0) {
+            found = workercpair(points, stored, workers, pair, process);
+        } else {
+            found = threadedcpair(points, stored, (threads == 0) ? 1 : threads, cutoff, pair, process);
+        }
+        if (found != 2) {
+            releasepoints(points);
+            exit(EXIT_FAILURE);
+        }
+        traceevent("solve", phase);
+        if (stats) {
+            printstats(process, depth, stored, 0, 0);
+        }
+        outputpair(pair, binaryParent, process);
+        releasepoints(points);
+        exit(EXIT_SUCCESS);
+    }
+
+    // The median split keeps both halves the same size, however skewed the points are
+    if (shared && sharedFd == -1) {
+        points = sharedcreate(points, stored, &sharedFd, process);
+    }
+
+    phase = tracetime();
+    char axis = (sameX == stored) ? 'y' : 'x';
+    float split = medianpx(points, stored, axis);
+    size_t storedLeft = (size_t)stored / 2;
+    if (stats) {
+        printstats(process, depth, stored, storedLeft, stored - storedLeft);
+    }
+    traceevent("split", phase);
+
+    childoptions options = {
+        .binary = binaryChildren, .levels = bounded ? levels - 1 : -1, .threads = threads, .cutoff = cutoff,
+        .stats = stats, .trace = tracePath, .depth = depth + 1,
+        .sharedFd = sharedFd, .sharedOffset = shared ? sharedoffset(points) : 0, .sharedStored = storedLeft
+    };
+    phase = tracetime();
+
     // Parent writes to this
     int leftWritePipe[2];
     int rightWritePipe[2];
@@ -406,64 +1159,36 @@ int main(int argc, char *argv[]) {
     int leftReadPipe[2];
     int rightReadPipe[2];
 
-    if (pipe(leftWritePipe) == -1 || pipe(rightWritePipe) == -1 ||
-        pipe(leftReadPipe) == -1 || pipe(rightReadPipe) == -1)
+    if (pipecloexec(leftWritePipe) == -1 || pipecloexec(rightWritePipe) == -1 ||
+        pipecloexec(leftReadPipe) == -1 || pipecloexec(rightReadPipe) == -1)
     {
         fprintf(stderr, "[%s] ERROR: Cannot pipe\n", process);
-        free(points);
+        releasepoints(points);
         exit(EXIT_FAILURE);
     }
 
-    pid_t leftChild = fork();
+    // 1 is the write end of a pipe
+    // 0 is the read end of a pipe
+    pid_t leftChild = spawnchild(process, &options, leftWritePipe[0], leftReadPipe[1]);
 
     if (leftChild == -1) {
-        fprintf(stderr, "[%s] ERROR: Cannot fork\n", process);
-        closepipes(rightReadPipe, leftReadPipe, rightWritePipe, leftWritePipe);
-        free(points);
-        exit(EXIT_FAILURE);
-    }
-
-    if (leftChild == 0) {
-        // 1 is the write end of a pipe
-        // 0 is the read end of a pipe
-        if (dup2(leftReadPipe[1], STDOUT_FILENO) == -1 ||
-            dup2(leftWritePipe[0], STDIN_FILENO) == -1) {
-            error("Error duplicating pipes", process);
-            exit(EXIT_FAILURE);
-        }
+        fprintf(stderr, "[%s] ERROR: Cannot spawn: %s\n", process, strerror(errno));
         closepipes(rightReadPipe, leftReadPipe, rightWritePipe, leftWritePipe);
-        execlp(process, process, NULL);
-
-        fprintf(stderr, "[%s] ERROR: Cannot exec: %s\n", process, strerror(errno));
-        free(points);
+        releasepoints(points);
         exit(EXIT_FAILURE);
     }
 
-    pid_t rightChild = fork();
+    options.sharedOffset += storedLeft;
+    options.sharedStored = stored - storedLeft;
+    pid_t rightChild = spawnchild(process, &options, rightWritePipe[0], rightReadPipe[1]);
 
     if (rightChild == -1) {
-        fprintf(stderr, "[%s] ERROR: Cannot fork\n", process);
+        fprintf(stderr, "[%s] ERROR: Cannot spawn: %s\n", process, strerror(errno));
         closepipes(rightReadPipe, leftReadPipe, rightWritePipe, leftWritePipe);
-        free(points);
+        releasepoints(points);
         exit(EXIT_FAILURE);
     }
 
-    if (rightChild == 0) {
-        // 1 is the write end of a pipe
-        // 0 is the read end of a pipe
-        if (dup2(rightReadPipe[1], STDOUT_FILENO) == -1 ||
-            dup2(rightWritePipe[0], STDIN_FILENO) == -1) {
-            error("Error duplicating pipes", process);
-            exit(EXIT_FAILURE);
-        }
-
-        closepipes(rightReadPipe, leftReadPipe, rightWritePipe, leftWritePipe);
-        execlp(process, process, NULL);
-
-        fprintf(stderr, "[%s] ERROR: Cannot exec: %s\n", process, strerror(errno));
-        free(points);
-        exit(EXIT_FAILURE);
-    }
     // 1 is the write end of a pipe
     // 0 is the read end of a pipe
     // Close off unused pipe ends (parent)
@@ -485,7 +1210,7 @@ int main(int argc, char *argv[]) {
         rightReadFile == NULL || rightWriteFile == NULL)
     {
         fprintf(stderr, "[%s] ERROR: Cannot create file descriptor: %s\n", process, strerror(errno));
-        free(points);
+        releasepoints(points);
 
         close(leftWritePipe[1]);
         close(rightWritePipe[1]);
@@ -498,25 +1223,36 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    (sameX == stored) ?
-    ptoc(points, stored, 'y', leftWriteFile, rightWriteFile):
-    ptoc(points, stored, 'x', leftWriteFile, rightWriteFile);
+    traceevent("spawn", phase);
+    phase = tracetime();
+
+    // Children with shared memory already see their points, their stdin just gets closed
+    if (binaryChildren && !shared) {
+        if (ptocbinary(points, stored, storedLeft, fileno(leftWriteFile), fileno(rightWriteFile)) == -1) {
+            fprintf(stderr, "[%s] ERROR: Cannot write to child: %s\n", process, strerror(errno));
+        }
+    } else if (!shared) {
+        ptoc(points, stored, storedLeft, leftWriteFile, rightWriteFile);
+    }
 
     fflush(leftWriteFile);
     fflush(rightWriteFile);
     fclose(leftWriteFile);
     fclose(rightWriteFile);
+    traceevent("send", phase);
 
+    phase = tracetime();
     int statusLeft, statusRight;
     waitpid(leftChild, &statusLeft, 0);
     waitpid(rightChild, &statusRight, 0);
+    traceevent("wait", phase);
 
     if (WEXITSTATUS(statusLeft) == EXIT_FAILURE) {
-        free(points);
+        releasepoints(points);
         exit(EXIT_FAILURE);
     }
     if (WEXITSTATUS(statusRight) == EXIT_FAILURE) {
-        free(points);
+        releasepoints(points);
         exit(EXIT_FAILURE);
     }
 
@@ -524,26 +1260,34 @@ int main(int argc, char *argv[]) {
     point child2Points[2];
     point mergedChildren[2];
 
-    size_t a = ctop(leftReadFile, child1Points, process);
-    size_t b = ctop(rightReadFile, child2Points, process);
+    phase = tracetime();
+    size_t a;
+    size_t b;
+    if (binaryChildren) {
+        a = ctopbinary(fileno(leftReadFile), child1Points, process);
+        b = ctopbinary(fileno(rightReadFile), child2Points, process);
+    } else {
+        a = ctop(leftReadFile, child1Points, process);
+        b = ctop(rightReadFile, child2Points, process);
+    }
 
     close(leftWritePipe[1]);
     close(rightWritePipe[1]);
     close(leftReadPipe[0]);
     close(rightReadPipe[0]);
+    traceevent("receive", phase);
 
-    char axis = (sameX == stored) ? 'y' : 'x';
-    float mean = meanpx(points, stored, axis);
-
+    phase = tracetime();
     if ((mergechildren(child1Points, a, child2Points, b, mergedChildren)) != 0) {
-        free(points);
+        releasepoints(points);
         exit(EXIT_FAILURE);
     }
 
-    mergefinal(points, stored, mergedChildren, mean, axis);
+    mergefinal(points, stored, mergedChildren, split, axis, process);
+    traceevent("merge", phase);
 
-    printpairsorted(stdout, mergedChildren, process);
+    outputpair(mergedChildren, binaryParent, process);
 
-    free(points);
+    releasepoints(points);
     return EXIT_SUCCESS;
 }
@@ -1,8 +1,420 @@
-//
-// Created by ivan on 11/1/23.
-//
+/**
+ * @file cpair.h
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief Shared types and helpers of the closest pair program.
+ **/
 
 #ifndef OSVU_CPAIR_H
 #define OSVU_CPAIR_H
 
+#include "stdio.h"
+#include "stdint.h"
+#include "sys/types.h"
+
+typedef struct {
+    float x;
+    float y;
+} point;
+
+/**
+ * Points stored as structure of arrays, so that distance kernels can load several coordinates at once.
+ */
+typedef struct {
+    float *x;
+    float *y;
+} pointsoa;
+
+/**
+ * A pair of points together with their squared distance.
+ */
+typedef struct {
+    point pair[2];
+    float sq;
+} pointpair;
+
+/**
+ * A growable collection of pairs. In QUERY_KCLOSEST it is kept as a max heap on sq.
+ */
+typedef struct {
+    pointpair *pairs;
+    size_t stored;
+    size_t capacity;
+} pairset;
+
+typedef enum {
+    QUERY_KCLOSEST,
+    QUERY_RADIUS
+} querymode;
+
+/**
+ * Describes which pairs a query reports: the k closest ones or all within a radius.
+ */
+typedef struct {
+    querymode mode;
+    size_t k;
+    float radiusSq;
+    // The radius as given, for the -p coordinate types
+    double radius;
+} query;
+
+/**
+ * The coordinate type the -p specializations work with, see precision.c.
+ */
+typedef enum {
+    PRECISION_FLOAT,
+    PRECISION_DOUBLE,
+    PRECISION_FIXED
+} precision;
+
+/**
+ * The whole text of an input, mapped if it is a regular file and read into memory otherwise.
+ */
+typedef struct {
+    char *data;
+    size_t size;
+    int mapped;
+} textinput;
+
+/**
+ * The start of a k-d tree index file, followed by capacity nodes.
+ */
+typedef struct {
+    char magic[8];
+    uint64_t stored;
+    uint64_t capacity;
+    uint32_t root;
+    uint32_t reserved;
+    point best[2];
+    float bestSq;
+} kdheader;
+
+/**
+ * A node of the k-d tree, children are node indices or UINT32_MAX.
+ */
+typedef struct {
+    point p;
+    uint32_t left;
+    uint32_t right;
+} kdnode;
+
+/**
+ * An opened (and mapped) k-d tree index file.
+ */
+typedef struct {
+    int fd;
+    int writable;
+    size_t mapped;
+    kdheader *header;
+    kdnode *nodes;
+} kdindex;
+
+void error(char *message, const char *process);
+point strtop(char *input, const char *process);
+void printpairsorted(FILE *file, point pair[2], const char *process);
+float coordinate(point p, char axis);
+float medianpx(point *points, size_t stored, char axis);
+float euclidean(point p1, point p2);
+float sqdistance(point p1, point p2);
+int countcoordinates(point *points, ssize_t stored, char axis);
+int mergechildren(point child1Points[2], size_t a, point child2Points[2], size_t b, point mergedChildren[2]);
+int comparey(const void *a, const void *b);
+size_t filterstrip(point *points, size_t stored, float mean, float bestSq, char axis, point *strip);
+void mergestrip(const float *x, const float *y, size_t stored, point mergedChildren[2]);
+void mergefinal(point *points, ssize_t stored, point mergedChildren[2], float mean, char axis, const char *process);
+
+/**
+ * @brief Starts a process with posix_spawn, with the given pipe ends as its stdin and stdout.
+ * @details Other descriptors are inherited as usual, so pipe ends the child must not keep should be close-on-exec.
+ * @param args The NULL terminated arguments, args[0] is the program, searched in PATH.
+ * @param input The descriptor that becomes stdin of the child.
+ * @param output The descriptor that becomes stdout of the child.
+ * @return The pid of the child, -1 if it could not be started (errno is set).
+ */
+pid_t spawnpiped(char *const args[], int input, int output);
+int pipecloexec(int fds[2]);
+int patofd(int fd, point *points, size_t stored);
+ssize_t fdtopa(int fd, point **points, const char *process);
+size_t ctopbinary(int fd, point points[2], const char *process);
+
+/**
+ * @brief Finds the candidate closest to a point.
+ * @param px The x coordinate of the point.
+ * @param py The y coordinate of the point.
+ * @param x The x coordinates of the candidates.
+ * @param y The y coordinates of the candidates.
+ * @param count The amount of candidates.
+ * @param index &mut The index of the closest candidate.
+ * @return The squared distance to the closest candidate, INFINITY if there are none.
+ */
+float nearest(float px, float py, const float *x, const float *y, size_t count, size_t *index);
+
+/**
+ * @brief Returns the squared distance of two points with the given amount of coordinates each.
+ * @param a The coordinates of the first point.
+ * @param b The coordinates of the second point.
+ * @param dimension The amount of coordinates.
+ */
+float sqdistancen(const float *a, const float *b, size_t dimension);
+
+/**
+ * @brief Makes all text of a file descriptor available, mapping it into memory if it is a regular file.
+ * @param fd The file descriptor you intend to read from.
+ * @param text &mut The text, released with textclose.
+ * @param process The name of the current process.
+ */
+void textopen(int fd, textinput *text, const char *process);
+
+/**
+ * @brief Releases the text of textopen.
+ * @param text &mut The text you intend to release.
+ */
+void textclose(textinput *text);
+
+/**
+ * @brief Scans one float starting at *cursor and advances the cursor past it, see loader.c.
+ * @details Anything the fast path does not handle (inf, nan, hex floats, very long mantissas) goes to strtof.
+ * @param cursor &mut The current position in the input.
+ * @param end The end of the input.
+ * @param value &mut The parsed value.
+ * @return 0 if successful -1 if there is no valid float at the cursor.
+ */
+int scanfloat(const char **cursor, const char *end, float *value);
+
+/**
+ * @brief Scans one double starting at *cursor and advances the cursor past it, like scanfloat.
+ */
+int scandouble(const char **cursor, const char *end, double *value);
+
+/**
+ * @brief Opens an input file for reading, exits if it cannot be opened.
+ * @param path The path of the file.
+ * @param process The name of the current process.
+ * @return The file descriptor.
+ */
+int openinput(const char *path, const char *process);
+
+/**
+ * @brief Loads text points from a file descriptor, mapping it into memory if it is a regular file.
+ * @details Dynamically allocates memory to store the points.
+ * @param fd The file descriptor you intend to read from.
+ * @param points &mut A pointer to an UNINITIALISED point array.
+ * @param process The name of the current process.
+ * @return The amount of points loaded.
+ */
+ssize_t loadpoints(int fd, point **points, const char *process);
+
+/**
+ * @brief Loads text points from the file at the given path.
+ * @param path The path of the file you intend to load.
+ * @param points &mut A pointer to an UNINITIALISED point array.
+ * @param process The name of the current process.
+ * @return The amount of points loaded.
+ */
+ssize_t filetopa(const char *path, point **points, const char *process);
+
+/**
+ * @brief Finds the closest pair inside the current process using a work-stealing thread pool.
+ * @param points &mut The points you intend to search, they get reordered in place.
+ * @param stored The amount of points in the point array.
+ * @param threads The amount of threads working on the problem (including the calling one).
+ * @param cutoff Subproblems smaller than this are solved sequentially instead of being spawned as tasks.
+ * @param pair &mut An array of 2 points the closest pair gets written to.
+ * @param process The name of the current process.
+ * @return The amount of points written to pair (0 or 2).
+ */
+size_t threadedcpair(point *points, size_t stored, size_t threads, size_t cutoff, point pair[2], const char *process);
+
+/**
+ * @brief Finds the closest pair with a hash grid whose cell size comes from the closest pair of a random sample.
+ * @details Runs in expected linear time on roughly uniform inputs, see grid.c.
+ * @param points &mut The points you intend to search, they get reordered in place.
+ * @param stored The amount of points in the point array.
+ * @param pair &mut An array of 2 points the closest pair gets written to.
+ * @param process The name of the current process.
+ * @return The amount of points written to pair (0 or 2).
+ */
+size_t gridcpair(point *points, size_t stored, point pair[2], const char *process);
+
+/**
+ * @brief Opens an index file, creating an empty index if it does not exist and writable is set.
+ * @param index &mut The index you intend to open.
+ * @param path The path of the index file.
+ * @param writable Whether points are going to be inserted.
+ * @param process The name of the current process.
+ * @return 0 if successful -1 otherwise
+ */
+int kdopen(kdindex *index, const char *path, int writable, const char *process);
+
+/**
+ * @brief Writes back and unmaps an index.
+ * @param index &mut The index you intend to close.
+ */
+void kdclose(kdindex *index);
+
+/**
+ * @brief Inserts points into an index and updates its closest pair.
+ * @details The first batch of an empty index is built as a balanced tree, later inserts rebuild
+ * subtrees that got out of balance.
+ * @param index &mut An index opened as writable.
+ * @param points &mut The points you intend to insert, they may get reordered.
+ * @param stored The amount of points in the point array.
+ * @param process The name of the current process.
+ */
+void kdinsert(kdindex *index, point *points, size_t stored, const char *process);
+
+/**
+ * @brief Returns the closest pair of all points in an index.
+ * @param index The index.
+ * @param pair &mut An array of 2 points the closest pair gets written to.
+ * @return The amount of points written to pair (0 or 2).
+ */
+size_t kdclosest(const kdindex *index, point pair[2]);
+
+/**
+ * @brief Finds the nearest indexed point of every probe.
+ * @param index The index.
+ * @param probes The points you intend to look up.
+ * @param stored The amount of probes.
+ * @param results &mut An array with room for stored points.
+ * @param process The name of the current process.
+ * @return 0 if successful -1 if the index is empty.
+ */
+int kdnearest(const kdindex *index, point *probes, size_t stored, point *results, const char *process);
+
+/**
+ * @brief Maintains the closest pair of a stream of text points, printing it whenever it changes.
+ * @details Works on the points as they arrive, so the input does not have to end, see stream.c.
+ * @param input The stream you intend to read points from, one per line.
+ * @param output The file the pairs get printed to.
+ * @param process The name of the current process.
+ * @return 0 if successful -1 if the stream held no points.
+ */
+int streamcpair(FILE *input, FILE *output, const char *process);
+
+/**
+ * @brief Answers a query for several pairs inside the current process, see threadedcpair.
+ * @details Each subproblem collects its own pairs (at most k of them for QUERY_KCLOSEST),
+ * which are combined when the two halves get merged. Only pairs crossing the split line are taken from the strip.
+ * @param points &mut The points you intend to search, they get reordered in place.
+ * @param stored The amount of points in the point array.
+ * @param threads The amount of threads working on the problem (including the calling one).
+ * @param cutoff Subproblems smaller than this are solved sequentially instead of being spawned as tasks.
+ * @param q The query you intend to answer.
+ * @param result &mut An UNINITIALISED set that receives the pairs, sorted by ascending distance.
+ * @param process The name of the current process.
+ */
+void threadedquery(point *points, size_t stored, size_t threads, size_t cutoff, const query *q, pairset *result,
+                   const char *process);
+
+/**
+ * @brief Parses the name of a precision (float, double or fixed).
+ * @param str The string you intend to convert.
+ * @param value &mut The parsed precision.
+ * @return 0 if successful -1 otherwise
+ */
+int parseprecision(const char *str, precision *value);
+
+/**
+ * @brief Reads text points and prints their closest pair or the pairs of a query, using the given coordinate type.
+ * @details The points are solved by the engine of threadedcpair, instantiated for the coordinate type.
+ * double keeps the input precision of geo coordinates, fixed stores coordinates as int64 millionths
+ * and compares exact squared distances. Pairs are printed with as many decimals as the type keeps.
+ * The input is loaded like with loadpoints.
+ * @param type The coordinate type, PRECISION_DOUBLE or PRECISION_FIXED.
+ * @param fd The file descriptor you intend to read points from.
+ * @param output The file the pairs get printed to.
+ * @param threads The amount of threads working on the problem (including the calling one).
+ * @param cutoff Subproblems smaller than this are solved sequentially instead of being spawned as tasks.
+ * @param q The query you intend to answer, NULL for only the closest pair.
+ * @param process The name of the current process.
+ * @return The amount of points read, nothing is printed if there are fewer than 2.
+ */
+ssize_t precisecpair(precision type, int fd, FILE *output, size_t threads, size_t cutoff, const query *q,
+                     const char *process);
+
+/**
+ * @brief Reads points of any dimension and prints their closest pair, see vector.c.
+ * @details The dimension is the amount of coordinates on the first line, every other line must have as many.
+ * @param input The stream you intend to read points from, one per line.
+ * @param output The file the pair gets printed to.
+ * @param process The name of the current process.
+ * @return 0 if successful -1 if the input held no points.
+ */
+int vectorcpair(FILE *input, FILE *output, const char *process);
+
+/**
+ * @brief Starts tracing this process into a Chrome trace file, see trace.c.
+ * @details The events are written when the process exits. The root (depth 0) truncates the file.
+ * @param path The path of the trace file.
+ * @param depth The depth of this process in the tree.
+ * @param process The name of the current process.
+ */
+void traceopen(const char *path, long depth, const char *process);
+
+/**
+ * @brief Returns the current time in microseconds, for use as the start of an event.
+ */
+double tracetime(void);
+
+/**
+ * @brief Records the amount of points this process handles.
+ */
+void tracepoints(size_t stored);
+
+/**
+ * @brief Records an event that started at the given time and ends now, does nothing if tracing is off.
+ * @param name The name of the event.
+ * @param start The start of the event, from tracetime.
+ */
+void traceevent(const char *name, double start);
+
+/**
+ * @brief Finds the closest pair with a pool of worker processes that are spawned once, see workers.c.
+ * @param points &mut The points you intend to search, they get reordered in place.
+ * @param stored The amount of points in the point array.
+ * @param count The amount of worker processes.
+ * @param pair &mut An array of 2 points the closest pair gets written to.
+ * @param process The name of the current process, also the program the workers run.
+ * @return The amount of points written to pair (0 or 2).
+ */
+size_t workercpair(point *points, size_t stored, size_t count, point pair[2], const char *process);
+
+/**
+ * @brief Answers jobs from stdin until it is closed, the main loop of a worker process.
+ * @param process The name of the current process.
+ * @return 0 once stdin is closed.
+ */
+int workerloop(const char *process);
+
+/**
+ * @brief Moves points into a new shared memory object that children of the process tree inherit, see shared.c.
+ * @param points &mut A malloc'd point array, it gets freed.
+ * @param stored The amount of points in the point array, at least 1.
+ * @param fd &mut The inheritable descriptor of the object.
+ * @param process The name of the current process.
+ * @return The points inside the shared memory object.
+ */
+point *sharedcreate(point *points, size_t stored, int *fd, const char *process);
+
+/**
+ * @brief Maps the range of a shared memory object given to this process by its parent.
+ * @param spec The range as FD:OFFSET:COUNT, offset and count in points.
+ * @param points &mut The first point of the range.
+ * @param fd &mut The descriptor of the object.
+ * @param process The name of the current process.
+ * @return The amount of points in the range.
+ */
+ssize_t sharedopen(const char *spec, point **points, int *fd, const char *process);
+
+/**
+ * @brief Returns the position of a point of the shared memory object within it.
+ */
+size_t sharedoffset(const point *points);
+
+/**
+ * @brief Frees the points of this process, unmapping them if they are shared.
+ */
+void releasepoints(point *points);
+
 #endif //OSVU_CPAIR_H
@@ -0,0 +1,24 @@
+/**
+ * @file engine.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The in-process closest pair engine.
+ * @details Instantiates engine.h for float points, the base case and the strip use the nearest kernel.
+ * precision.c instantiates the same engine for its double and fixed point coordinates.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+#include "cpair.h"
+#include "threadpool.h"
+
+#define TYPED(name) name
+#define ENGINE
+#define COORD float
+#define DIST float
+#define SUM double
+#define DIFFSQ(a, b) (((a) - (b)) * ((a) - (b)))
+#define NEAREST(px, py, x, y, count, index) nearest(px, py, x, y, count, index)
+#define RADIUSSQ(q) ((q)->radiusSq)
+#include "engine.h"
@@ -0,0 +1,553 @@
+/**
+ * @file engine.h
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The in-process closest pair engine for one coordinate type.
+ * @details Runs the divide and conquer recursion of the process tree in cpair.c,
+ * but the subproblems are tasks of a thread pool instead of child processes.
+ * It splits around the mean instead of the median, because the query merge tells both halves
+ * apart by comparing coordinates with the split, which ties at the median would break.
+ * Every subproblem leaves its points sorted by y, so the strip around the split line
+ * comes out sorted without another sort and the whole recursion stays O(n log n).
+ * The points are kept as structure of arrays so the strip and the base case can use the nearest kernel.
+ *
+ * This file has no include guard on purpose, engine.c includes it for float and closest.h once per
+ * coordinate type of precision.c, after defining:
+ * - TYPED(name) the name of a type or function of this coordinate type, the types TYPED(point),
+ *   TYPED(pointsoa), TYPED(pointpair) and TYPED(pairset) have to exist already,
+ * - ENGINE the linkage of TYPED(threadedcpair) and TYPED(threadedquery) (empty or static),
+ * - COORD the type of a coordinate,
+ * - DIST the type of a squared distance,
+ * - SUM a type that holds the sum of all coordinates, for the mean,
+ * - DIFFSQ(a, b) the squared difference of two coordinates as a DIST,
+ * - NEAREST(px, py, x, y, count, index) the nearest of count >= 1 candidates, like nearest,
+ * - RADIUSSQ(q) the squared radius of a QUERY_RADIUS query as a DIST.
+ **/
+
+/**
+ * Subproblems of at most this many points are solved by comparing every pair.
+ */
+#define BRUTE_FORCE_LIMIT (8)
+
+typedef struct {
+    TYPED(pointsoa) points;
+    // Scratch space with room for stored points, disjoint from the one of every other running subproblem
+    TYPED(pointsoa) scratch;
+    size_t stored;
+    size_t cutoff;
+    const char *process;
+    TYPED(point) pair[2];
+    size_t found;
+    // Only used when answering a query for several pairs, NULL otherwise
+    const query *query;
+    DIST radiusSq;
+    TYPED(pairset) pairs;
+} TYPED(subproblem);
+
+/**
+ * @brief Returns the given points offset by a number of entries.
+ */
+static TYPED(pointsoa) TYPED(offset)(TYPED(pointsoa) points, size_t by) {
+    TYPED(pointsoa) result = {.x = points.x + by, .y = points.y + by};
+    return result;
+}
+
+/**
+ * @brief Swaps two entries of a structure of arrays.
+ */
+static void TYPED(swap)(TYPED(pointsoa) points, size_t i, size_t j) {
+    COORD x = points.x[i];
+    COORD y = points.y[i];
+    points.x[i] = points.x[j];
+    points.y[i] = points.y[j];
+    points.x[j] = x;
+    points.y[j] = y;
+}
+
+/**
+ * @brief Returns the point at entry i of a structure of arrays.
+ */
+static TYPED(point) TYPED(entry)(TYPED(pointsoa) points, size_t i) {
+    TYPED(point) p = {points.x[i], points.y[i]};
+    return p;
+}
+
+/**
+ * @brief Returns the squared distance of two points.
+ */
+static DIST TYPED(pairsq)(TYPED(point) p1, TYPED(point) p2) {
+    return DIFFSQ(p1.x, p2.x) + DIFFSQ(p1.y, p2.y);
+}
+
+/**
+ * @brief Checks whether entry i comes before entry j when ordered by y (and x on ties).
+ */
+static int TYPED(lessy)(TYPED(pointsoa) points, size_t i, size_t j) {
+    return points.y[i] < points.y[j] || (points.y[i] == points.y[j] && points.x[i] < points.x[j]);
+}
+
+/**
+ * @brief Sorts a few points by y, used for the base cases.
+ */
+static void TYPED(insertionsorty)(TYPED(pointsoa) points, size_t stored) {
+    for (size_t i = 1; i < stored; i++) {
+        for (size_t j = i; j > 0 && TYPED(lessy)(points, j, j - 1); j--) {
+            TYPED(swap)(points, j, j - 1);
+        }
+    }
+}
+
+/**
+ * @brief Finds the closest pair by comparing every pair of points.
+ * @param points The points you intend to search.
+ * @param stored The amount of points.
+ * @param pair &mut An array of 2 points the closest pair gets written to.
+ * @return The amount of points written to pair (0 or 2).
+ */
+static size_t TYPED(bruteforce)(TYPED(pointsoa) points, size_t stored, TYPED(point) pair[2]) {
+    if (stored < 2) {
+        return 0;
+    }
+
+    DIST bestSq = 0;
+    for (size_t i = 0; i + 1 < stored; i++) {
+        size_t index;
+        DIST distance = NEAREST(points.x[i], points.y[i], points.x + i + 1, points.y + i + 1, stored - i - 1, &index);
+        if (distance < bestSq || i == 0) {
+            bestSq = distance;
+            pair[0] = TYPED(entry)(points, i);
+            pair[1] = TYPED(entry)(points, i + 1 + index);
+        }
+    }
+    return 2;
+}
+
+/**
+ * @brief Counts the coordinates that are identical to the first one, like countcoordinates.
+ */
+static size_t TYPED(countsame)(const COORD *coordinates, size_t stored) {
+    size_t count = 0;
+    for (size_t i = 0; i < stored; i++) {
+        count += (coordinates[i] == coordinates[0]);
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the mean of the coordinates, summed in SUM so it stays within their range.
+ */
+static COORD TYPED(mean)(const COORD *coordinates, size_t stored) {
+    SUM sum = 0;
+    for (size_t i = 0; i < stored; i++) {
+        sum += coordinates[i];
+    }
+    return (COORD)(sum / (SUM)stored);
+}
+
+/**
+ * @brief Merges two runs of points that are each sorted by y.
+ * @param points &mut The left run directly followed by the right run.
+ * @param split The amount of points in the left run.
+ * @param stored The amount of points in both runs.
+ * @param scratch &mut Scratch space with room for stored points.
+ */
+static void TYPED(mergey)(TYPED(pointsoa) points, size_t split, size_t stored, TYPED(pointsoa) scratch) {
+    size_t i = 0;
+    size_t j = split;
+    size_t k = 0;
+
+    while (i < split && j < stored) {
+        size_t from = TYPED(lessy)(points, j, i) ? j++ : i++;
+        scratch.x[k] = points.x[from];
+        scratch.y[k] = points.y[from];
+        k++;
+    }
+    for (; i < split; i++, k++) {
+        scratch.x[k] = points.x[i];
+        scratch.y[k] = points.y[i];
+    }
+    for (; j < stored; j++, k++) {
+        scratch.x[k] = points.x[j];
+        scratch.y[k] = points.y[j];
+    }
+    memcpy(points.x, scratch.x, sizeof(COORD) * stored);
+    memcpy(points.y, scratch.y, sizeof(COORD) * stored);
+}
+
+/**
+ * @brief Reorders the points so that the ones that would be sent to the left child come first.
+ * @details Every point with a coordinate <= split goes to the left.
+ * @param points &mut The points you intend to partition.
+ * @param stored The amount of points.
+ * @param split The value the points get split around.
+ * @param axis The axis along which you intend to split the points.
+ * @return The amount of points on the left side.
+ */
+static size_t TYPED(partition)(TYPED(pointsoa) points, size_t stored, COORD split, char axis) {
+    const COORD *coordinates = (axis == 'x') ? points.x : points.y;
+    size_t left = 0;
+    for (size_t i = 0; i < stored; i++) {
+        if (coordinates[i] <= split) {
+            TYPED(swap)(points, left, i);
+            left++;
+        }
+    }
+    return left;
+}
+
+/**
+ * @brief Copies the points that lie closer than the best pair to the split line into the strip, like filterstrip.
+ * @return The amount of points in the strip.
+ */
+static size_t TYPED(filterstripsoa)(TYPED(pointsoa) points, size_t stored, COORD split, DIST bestSq, char axis,
+                                    TYPED(pointsoa) strip) {
+    const COORD *coordinates = (axis == 'x') ? points.x : points.y;
+    size_t storedStrip = 0;
+    for (size_t i = 0; i < stored; i++) {
+        if (DIFFSQ(coordinates[i], split) < bestSq) {
+            strip.x[storedStrip] = points.x[i];
+            strip.y[storedStrip] = points.y[i];
+            storedStrip++;
+        }
+    }
+    return storedStrip;
+}
+
+/**
+ * @brief Improves the closest pair with the pairs of a strip that is sorted by y, like mergestrip.
+ */
+static void TYPED(scanstrip)(TYPED(pointsoa) strip, size_t stored, TYPED(point) pair[2]) {
+    DIST bestSq = TYPED(pairsq)(pair[0], pair[1]);
+
+    for (size_t i = 0; i + 1 < stored; i++) {
+        size_t end = i + 1;
+        while (end < stored && DIFFSQ(strip.y[end], strip.y[i]) < bestSq) {
+            end++;
+        }
+        if (end == i + 1) {
+            continue;
+        }
+
+        size_t index;
+        DIST distance = NEAREST(strip.x[i], strip.y[i], strip.x + i + 1, strip.y + i + 1, end - i - 1, &index);
+        if (distance < bestSq) {
+            bestSq = distance;
+            pair[0] = TYPED(entry)(strip, i);
+            pair[1] = TYPED(entry)(strip, i + 1 + index);
+        }
+    }
+}
+
+/**
+ * @brief Checks whether a pair with the given squared distance would still be part of the answer.
+ */
+static int TYPED(within)(const TYPED(subproblem) *sp, DIST sq) {
+    if (sp->query->mode == QUERY_RADIUS) {
+        return sq <= sp->radiusSq;
+    }
+    return sp->pairs.stored < sp->query->k || sq < sp->pairs.pairs[0].sq;
+}
+
+/**
+ * @brief Appends a pair to a set, growing it if needed.
+ */
+static void TYPED(pairsetpush)(TYPED(pairset) *set, TYPED(pointpair) pair, const char *process) {
+    if (set->stored == set->capacity) {
+        size_t capacity = (set->capacity == 0) ? 16 : set->capacity * 2;
+        TYPED(pointpair) *tmp = realloc(set->pairs, sizeof(TYPED(pointpair)) * capacity);
+        if (tmp == NULL) {
+            free(set->pairs);
+            error("Failed to allocate memory", process);
+        }
+        set->pairs = tmp;
+        set->capacity = capacity;
+    }
+    set->pairs[set->stored] = pair;
+    set->stored++;
+}
+
+/**
+ * @brief Restores the max heap property of a set after its root was replaced.
+ */
+static void TYPED(siftdown)(TYPED(pairset) *set) {
+    size_t i = 0;
+    for (;;) {
+        size_t largest = i;
+        size_t left = 2 * i + 1;
+        size_t right = 2 * i + 2;
+        if (left < set->stored && set->pairs[left].sq > set->pairs[largest].sq) {
+            largest = left;
+        }
+        if (right < set->stored && set->pairs[right].sq > set->pairs[largest].sq) {
+            largest = right;
+        }
+        if (largest == i) {
+            return;
+        }
+        TYPED(pointpair) tmp = set->pairs[i];
+        set->pairs[i] = set->pairs[largest];
+        set->pairs[largest] = tmp;
+        i = largest;
+    }
+}
+
+/**
+ * @brief Adds a pair to the answer of a subproblem if it qualifies.
+ * @details In QUERY_KCLOSEST the set is a max heap holding at most k pairs, so a full heap
+ * only takes pairs closer than its root, which they replace.
+ */
+static void TYPED(offer)(TYPED(subproblem) *sp, TYPED(pointpair) pair) {
+    if (!TYPED(within)(sp, pair.sq)) {
+        return;
+    }
+
+    TYPED(pairset) *set = &sp->pairs;
+    if (sp->query->mode == QUERY_RADIUS) {
+        TYPED(pairsetpush)(set, pair, sp->process);
+        return;
+    }
+
+    if (set->stored < sp->query->k) {
+        TYPED(pairsetpush)(set, pair, sp->process);
+        for (size_t i = set->stored - 1; i > 0 && set->pairs[(i - 1) / 2].sq < set->pairs[i].sq; i = (i - 1) / 2) {
+            TYPED(pointpair) tmp = set->pairs[i];
+            set->pairs[i] = set->pairs[(i - 1) / 2];
+            set->pairs[(i - 1) / 2] = tmp;
+        }
+        return;
+    }
+
+    set->pairs[0] = pair;
+    TYPED(siftdown)(set);
+}
+
+/**
+ * @brief Offers every pair of a small (or completely identical) subproblem.
+ */
+static void TYPED(bruteforcequery)(TYPED(subproblem) *sp) {
+    for (size_t i = 0; i + 1 < sp->stored; i++) {
+        for (size_t j = i + 1; j < sp->stored; j++) {
+            TYPED(pointpair) pair = {.pair = {TYPED(entry)(sp->points, i), TYPED(entry)(sp->points, j)}};
+            pair.sq = TYPED(pairsq)(pair.pair[0], pair.pair[1]);
+            TYPED(offer)(sp, pair);
+        }
+
+        // Once k pairs at distance 0 are known nothing can improve them
+        if (sp->query->mode == QUERY_KCLOSEST && sp->pairs.stored == sp->query->k && sp->pairs.pairs[0].sq == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Combines the answers of both halves and adds the pairs crossing the split line.
+ * @details The points of the subproblem have to be sorted by y already.
+ * @param sp &mut The subproblem.
+ * @param left &mut The solved left half, its pairs are taken over.
+ * @param right &mut The solved right half, its pairs are freed.
+ * @param split The value the points were split around.
+ * @param axis The axis along which the points were split.
+ */
+static void TYPED(mergequery)(TYPED(subproblem) *sp, TYPED(subproblem) *left, TYPED(subproblem) *right, COORD split,
+                              char axis) {
+    sp->pairs = left->pairs;
+    for (size_t i = 0; i < right->pairs.stored; i++) {
+        TYPED(offer)(sp, right->pairs.pairs[i]);
+    }
+    free(right->pairs.pairs);
+
+    const COORD *coordinates = (axis == 'x') ? sp->points.x : sp->points.y;
+    TYPED(pointsoa) strip = sp->scratch;
+    size_t storedStrip = 0;
+    for (size_t i = 0; i < sp->stored; i++) {
+        if (TYPED(within)(sp, DIFFSQ(coordinates[i], split))) {
+            strip.x[storedStrip] = sp->points.x[i];
+            strip.y[storedStrip] = sp->points.y[i];
+            storedStrip++;
+        }
+    }
+
+    const COORD *stripCoordinates = (axis == 'x') ? strip.x : strip.y;
+    for (size_t i = 0; i < storedStrip; i++) {
+        int leftSide = stripCoordinates[i] <= split;
+        for (size_t j = i + 1; j < storedStrip; j++) {
+            DIST dySq = DIFFSQ(strip.y[j], strip.y[i]);
+            if (!TYPED(within)(sp, dySq)) {
+                break;
+            }
+
+            // Pairs on the same side were already found by the halves
+            if ((stripCoordinates[j] <= split) == leftSide) {
+                continue;
+            }
+
+            TYPED(pointpair) pair = {
+                .pair = {TYPED(entry)(strip, i), TYPED(entry)(strip, j)}, .sq = DIFFSQ(strip.x[j], strip.x[i]) + dySq
+            };
+            TYPED(offer)(sp, pair);
+        }
+    }
+}
+
+/**
+ * @brief Solves a subproblem, spawning the left half as a task if it is large enough.
+ * @param self The worker running the subproblem.
+ * @param arg &mut The subproblem.
+ */
+static void TYPED(solve)(poolworker *self, void *arg) {
+    TYPED(subproblem) *sp = arg;
+    sp->found = 0;
+
+    if (sp->stored <= BRUTE_FORCE_LIMIT) {
+        if (sp->query != NULL) {
+            TYPED(bruteforcequery)(sp);
+        } else {
+            sp->found = TYPED(bruteforce)(sp->points, sp->stored, sp->pair);
+        }
+        TYPED(insertionsorty)(sp->points, sp->stored);
+        return;
+    }
+
+    size_t sameX = TYPED(countsame)(sp->points.x, sp->stored);
+    size_t sameY = TYPED(countsame)(sp->points.y, sp->stored);
+
+    // Take care of the case when all points are identical, they are already sorted then
+    if (sameX == sp->stored && sameY == sp->stored) {
+        if (sp->query != NULL) {
+            TYPED(bruteforcequery)(sp);
+            return;
+        }
+        sp->pair[0] = TYPED(entry)(sp->points, 0);
+        sp->pair[1] = sp->pair[0];
+        sp->found = 2;
+        return;
+    }
+
+    char axis = (sameX == sp->stored) ? 'y' : 'x';
+    const COORD *coordinates = (axis == 'x') ? sp->points.x : sp->points.y;
+    COORD split = TYPED(mean)(coordinates, sp->stored);
+    size_t storedLeft = TYPED(partition)(sp->points, sp->stored, split, axis);
+
+    // Rounding of the mean can leave one side empty, which would never terminate,
+    // so split off the points with the smallest coordinate instead
+    if (storedLeft == 0 || storedLeft == sp->stored) {
+        split = coordinates[0];
+        for (size_t i = 1; i < sp->stored; i++) {
+            split = (coordinates[i] < split) ? coordinates[i] : split;
+        }
+        storedLeft = TYPED(partition)(sp->points, sp->stored, split, axis);
+    }
+
+    TYPED(subproblem) left = {
+        .points = sp->points, .scratch = sp->scratch, .stored = storedLeft,
+        .cutoff = sp->cutoff, .process = sp->process, .query = sp->query, .radiusSq = sp->radiusSq
+    };
+    TYPED(subproblem) right = {
+        .points = TYPED(offset)(sp->points, storedLeft), .scratch = TYPED(offset)(sp->scratch, storedLeft),
+        .stored = sp->stored - storedLeft, .cutoff = sp->cutoff, .process = sp->process, .query = sp->query,
+        .radiusSq = sp->radiusSq
+    };
+
+    if (sp->stored >= sp->cutoff) {
+        pooltask task = {.run = TYPED(solve), .arg = &left};
+        poolspawn(self, &task);
+        TYPED(solve)(self, &right);
+        pooljoin(self, &task);
+    } else {
+        TYPED(solve)(self, &left);
+        TYPED(solve)(self, &right);
+    }
+
+    TYPED(mergey)(sp->points, storedLeft, sp->stored, sp->scratch);
+
+    if (sp->query != NULL) {
+        TYPED(mergequery)(sp, &left, &right, split, axis);
+        return;
+    }
+
+    // Like mergechildren, the better pair of both halves is the one to beat
+    if (left.found != 2 && right.found != 2) {
+        return;
+    }
+    const TYPED(point) *better = left.pair;
+    if (left.found != 2 ||
+        (right.found == 2 && TYPED(pairsq)(right.pair[0], right.pair[1]) < TYPED(pairsq)(left.pair[0], left.pair[1]))) {
+        better = right.pair;
+    }
+    sp->pair[0] = better[0];
+    sp->pair[1] = better[1];
+
+    DIST bestSq = TYPED(pairsq)(sp->pair[0], sp->pair[1]);
+    size_t storedStrip = TYPED(filterstripsoa)(sp->points, sp->stored, split, bestSq, axis, sp->scratch);
+    TYPED(scanstrip)(sp->scratch, storedStrip, sp->pair);
+    sp->found = 2;
+}
+
+/**
+ * @brief Sets up the pool and the structure of arrays and solves the root subproblem.
+ * @param points The points you intend to search.
+ * @param root &mut The root subproblem, with everything but the points and the scratch space set.
+ * @param threads The amount of threads working on the problem.
+ */
+static void TYPED(run)(TYPED(point) *points, TYPED(subproblem) *root, size_t threads) {
+    pool *p = poolcreate(threads);
+    if (p == NULL) {
+        error("Cannot create thread pool", root->process);
+    }
+
+    // One allocation holds the coordinates and the scratch space
+    size_t capacity = (root->stored > 0) ? root->stored : 1;
+    COORD *arena = malloc(sizeof(COORD) * 4 * capacity);
+    if (arena == NULL) {
+        pooldestroy(p);
+        error("Failed to allocate memory", root->process);
+    }
+
+    TYPED(pointsoa) soa = {.x = arena, .y = arena + capacity};
+    TYPED(pointsoa) scratch = {.x = arena + 2 * capacity, .y = arena + 3 * capacity};
+    for (size_t i = 0; i < root->stored; i++) {
+        soa.x[i] = points[i].x;
+        soa.y[i] = points[i].y;
+    }
+
+    root->points = soa;
+    root->scratch = scratch;
+    TYPED(solve)(poolmain(p), root);
+    pooldestroy(p);
+    free(arena);
+}
+
+ENGINE size_t TYPED(threadedcpair)(TYPED(point) *points, size_t stored, size_t threads, size_t cutoff,
+                                   TYPED(point) pair[2], const char *process) {
+    TYPED(subproblem) root = {.stored = stored, .cutoff = cutoff, .process = process};
+    TYPED(run)(points, &root, threads);
+
+    if (root.found == 2) {
+        pair[0] = root.pair[0];
+        pair[1] = root.pair[1];
+    }
+    return root.found;
+}
+
+/**
+ * @brief Orders pairs by ascending distance, for use with qsort.
+ */
+static int TYPED(comparepairs)(const void *a, const void *b) {
+    const TYPED(pointpair) *p1 = a;
+    const TYPED(pointpair) *p2 = b;
+    return (p1->sq > p2->sq) - (p1->sq < p2->sq);
+}
+
+ENGINE void TYPED(threadedquery)(TYPED(point) *points, size_t stored, size_t threads, size_t cutoff, const query *q,
+                                 TYPED(pairset) *result, const char *process) {
+    TYPED(subproblem) root = {.stored = stored, .cutoff = cutoff, .process = process, .query = q};
+    if (q->mode == QUERY_RADIUS) {
+        root.radiusSq = RADIUSSQ(q);
+    }
+    TYPED(run)(points, &root, threads);
+
+    qsort(root.pairs.pairs, root.pairs.stored, sizeof(TYPED(pointpair)), TYPED(comparepairs));
+    *result = root.pairs;
+}
+
+#undef BRUTE_FORCE_LIMIT
@@ -0,0 +1,216 @@
+/**
+ * @file grid.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The grid hashing closest pair engine.
+ * @details Follows Rabin's sampling idea: the closest pair of a random sample of n^(2/3) points
+ * gives a distance delta that is at least the true answer. Hashing every point into a grid of
+ * delta sized cells then puts the closest pair into the same or neighbouring cells, and for
+ * roughly uniform inputs only an expected O(n) amount of point pairs share neighbouring cells.
+ **/
+
+#include "stdlib.h"
+#include "stdint.h"
+#include "math.h"
+#include "cpair.h"
+
+/**
+ * Inputs smaller than this are handed to the divide and conquer engine directly.
+ */
+#define GRID_MIN_POINTS (64)
+
+/**
+ * Grids wider than this many cells per axis would overflow the cell coordinates.
+ */
+#define GRID_MAX_CELLS (4611686018427387904.0)
+
+typedef struct {
+    int64_t cx;
+    int64_t cy;
+    size_t cell;
+    int used;
+} gridslot;
+
+typedef struct {
+    gridslot *slots;
+    size_t mask;
+} gridtable;
+
+/**
+ * @brief A small xorshift generator, so the sample is the same on every run.
+ */
+static uint64_t xorshift(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Hashes the coordinates of a cell.
+ */
+static size_t hashcell(int64_t cx, int64_t cy) {
+    uint64_t h = (uint64_t)cx * 0x9E3779B97F4A7C15ULL ^ (uint64_t)cy * 0xC2B2AE3D27D4EB4FULL;
+    return (size_t)(h ^ (h >> 29));
+}
+
+/**
+ * @brief Finds the slot of a cell, which is either the used slot of that cell or the free slot it would go into.
+ */
+static gridslot *findslot(gridtable *table, int64_t cx, int64_t cy) {
+    size_t i = hashcell(cx, cy) & table->mask;
+    while (table->slots[i].used && (table->slots[i].cx != cx || table->slots[i].cy != cy)) {
+        i = (i + 1) & table->mask;
+    }
+    return &table->slots[i];
+}
+
+/**
+ * @brief Compares every point of cell a against a block of candidates, updating the best pair.
+ * @param grid The points ordered by cell.
+ * @param from The first point of cell a.
+ * @param to The point after the last one of cell a.
+ * @param candidates The first candidate.
+ * @param count The amount of candidates, for the own cell only the ones after the current point are used.
+ * @param sameCell Whether the candidates are cell a itself.
+ * @param bestSq &mut The squared distance of the best pair so far.
+ * @param pair &mut The best pair so far.
+ */
+static void comparecells(pointsoa grid, size_t from, size_t to, size_t candidates, size_t count, int sameCell,
+                         float *bestSq, point pair[2]) {
+    for (size_t i = from; i < to; i++) {
+        size_t first = sameCell ? i + 1 : candidates;
+        size_t amount = sameCell ? to - i - 1 : count;
+
+        size_t index;
+        float distance = nearest(grid.x[i], grid.y[i], grid.x + first, grid.y + first, amount, &index);
+        if (distance < *bestSq) {
+            *bestSq = distance;
+            pair[0] = (point){grid.x[i], grid.y[i]};
+            pair[1] = (point){grid.x[first + index], grid.y[first + index]};
+        }
+    }
+}
+
+size_t gridcpair(point *points, size_t stored, point pair[2], const char *process) {
+    if (stored < GRID_MIN_POINTS) {
+        return threadedcpair(points, stored, 1, stored + 1, pair, process);
+    }
+
+    // Move a random sample without repetitions to the front and solve it on its own
+    size_t sampleSize = (size_t)pow((double)stored, 2.0 / 3.0);
+    sampleSize = (sampleSize < 2) ? 2 : sampleSize;
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    for (size_t i = 0; i < sampleSize; i++) {
+        size_t j = i + (size_t)(xorshift(&state) % (stored - i));
+        point tmp = points[i];
+        points[i] = points[j];
+        points[j] = tmp;
+    }
+
+    if (threadedcpair(points, sampleSize, 1, sampleSize + 1, pair, process) != 2) {
+        return 0;
+    }
+
+    float bestSq = sqdistance(pair[0], pair[1]);
+    if (bestSq == 0.0f) {
+        return 2;
+    }
+
+    float delta = sqrtf(bestSq);
+    float minX = points[0].x;
+    float minY = points[0].y;
+    float maxX = points[0].x;
+    float maxY = points[0].y;
+    for (size_t i = 1; i < stored; i++) {
+        minX = (points[i].x < minX) ? points[i].x : minX;
+        minY = (points[i].y < minY) ? points[i].y : minY;
+        maxX = (points[i].x > maxX) ? points[i].x : maxX;
+        maxY = (points[i].y > maxY) ? points[i].y : maxY;
+    }
+
+    // A delta this small compared to the extent of the points cannot be expressed as a grid
+    if (((double)maxX - minX) / delta > GRID_MAX_CELLS || ((double)maxY - minY) / delta > GRID_MAX_CELLS) {
+        return threadedcpair(points, stored, 1, stored + 1, pair, process);
+    }
+
+    size_t tableSize = 1;
+    while (tableSize < 2 * stored) {
+        tableSize *= 2;
+    }
+
+    gridtable table = {.slots = calloc(tableSize, sizeof(gridslot)), .mask = tableSize - 1};
+    size_t *cellOf = malloc(sizeof(size_t) * stored);
+    size_t *start = calloc(stored + 1, sizeof(size_t));
+    gridslot **cells = malloc(sizeof(gridslot *) * stored);
+    float *coordinates = malloc(sizeof(float) * 2 * stored);
+
+    if (table.slots == NULL || cellOf == NULL || start == NULL || cells == NULL || coordinates == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    // Assign every point to its cell and count the points per cell
+    size_t storedCells = 0;
+    for (size_t i = 0; i < stored; i++) {
+        int64_t cx = (int64_t)(((double)points[i].x - minX) / delta);
+        int64_t cy = (int64_t)(((double)points[i].y - minY) / delta);
+        gridslot *slot = findslot(&table, cx, cy);
+
+        if (!slot->used) {
+            slot->used = 1;
+            slot->cx = cx;
+            slot->cy = cy;
+            slot->cell = storedCells;
+            cells[storedCells] = slot;
+            storedCells++;
+        }
+
+        cellOf[i] = slot->cell;
+        start[slot->cell + 1]++;
+    }
+
+    // Order the points by cell, so that every cell is one contiguous block
+    for (size_t c = 0; c < storedCells; c++) {
+        start[c + 1] += start[c];
+    }
+
+    pointsoa grid = {.x = coordinates, .y = coordinates + stored};
+    size_t *next = malloc(sizeof(size_t) * (storedCells > 0 ? storedCells : 1));
+    if (next == NULL) {
+        error("Failed to allocate memory", process);
+    }
+    for (size_t c = 0; c < storedCells; c++) {
+        next[c] = start[c];
+    }
+    for (size_t i = 0; i < stored; i++) {
+        size_t to = next[cellOf[i]]++;
+        grid.x[to] = points[i].x;
+        grid.y[to] = points[i].y;
+    }
+
+    // Every cell checks itself and the half of its neighbours that come after it
+    static const int64_t neighbours[4][2] = {{1, -1}, {1, 0}, {1, 1}, {0, 1}};
+    for (size_t c = 0; c < storedCells; c++) {
+        comparecells(grid, start[c], start[c + 1], 0, 0, 1, &bestSq, pair);
+
+        for (int n = 0; n < 4; n++) {
+            gridslot *neighbour = findslot(&table, cells[c]->cx + neighbours[n][0], cells[c]->cy + neighbours[n][1]);
+            if (!neighbour->used) {
+                continue;
+            }
+
+            size_t other = neighbour->cell;
+            comparecells(grid, start[c], start[c + 1], start[other], start[other + 1] - start[other], 0, &bestSq, pair);
+        }
+    }
+
+    free(next);
+    free(coordinates);
+    free(cells);
+    free(start);
+    free(cellOf);
+    free(table.slots);
+    return 2;
+}
@@ -0,0 +1,489 @@
+/**
+ * @file kdtree.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief A persistent 2-d tree index of points.
+ * @details The index file is a kdheader followed by an array of kdnode and is used through a shared mapping,
+ * so inserts go straight to the file and reopening it does not parse or rebuild anything.
+ * The first batch of an empty index is built balanced (median splits), later points are
+ * inserted one by one and unbalanced subtrees are rebuilt like in a scapegoat tree. Each insert first looks up the nearest neighbour of the new point,
+ * which keeps the closest pair stored in the header up to date.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "stdint.h"
+#include "unistd.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "math.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "cpair.h"
+
+#define KD_MAGIC "CPAIRKD1"
+#define KD_NONE (UINT32_MAX)
+#define KD_MIN_CAPACITY (1024)
+
+/**
+ * A subtree is rebuilt once one of its children holds more than this share of its nodes.
+ */
+#define KD_ALPHA (0.7)
+
+typedef struct {
+    uint32_t node;
+    uint32_t depth;
+    // Squared distance between the probe and the split line above this node
+    float boundSq;
+} kdentry;
+
+/**
+ * @brief Returns the coordinate a node at the given depth splits on.
+ */
+static float kdcoordinate(point p, uint32_t depth) {
+    return (depth % 2 == 0) ? p.x : p.y;
+}
+
+/**
+ * @brief Maps the index file with room for the given amount of nodes, growing the file if needed.
+ */
+static void kdmap(kdindex *index, size_t capacity, const char *process) {
+    size_t size = sizeof(kdheader) + sizeof(kdnode) * capacity;
+
+    if (index->header != NULL) {
+        munmap(index->header, index->mapped);
+        index->header = NULL;
+    }
+
+    if (index->writable && ftruncate(index->fd, (off_t)size) == -1) {
+        error("Cannot grow the index file", process);
+    }
+
+    int protection = index->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *data = mmap(NULL, size, protection, MAP_SHARED, index->fd, 0);
+    if (data == MAP_FAILED) {
+        error("Cannot map the index file", process);
+    }
+
+    index->mapped = size;
+    index->header = data;
+    index->nodes = (kdnode *)((char *)data + sizeof(kdheader));
+}
+
+int kdopen(kdindex *index, const char *path, int writable, const char *process) {
+    memset(index, 0, sizeof(kdindex));
+    index->writable = writable;
+    index->fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (index->fd == -1) {
+        fprintf(stderr, "[%s] ERROR: Cannot open %s: %s\n", process, path, strerror(errno));
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(index->fd, &info) == -1) {
+        close(index->fd);
+        return -1;
+    }
+
+    if (info.st_size == 0) {
+        if (!writable) {
+            fprintf(stderr, "[%s] ERROR: %s is an empty index\n", process, path);
+            close(index->fd);
+            return -1;
+        }
+
+        kdmap(index, KD_MIN_CAPACITY, process);
+        memcpy(index->header->magic, KD_MAGIC, sizeof(index->header->magic));
+        index->header->stored = 0;
+        index->header->capacity = KD_MIN_CAPACITY;
+        index->header->root = KD_NONE;
+        index->header->bestSq = INFINITY;
+        return 0;
+    }
+
+    kdheader header;
+    if ((size_t)info.st_size < sizeof(kdheader) || pread(index->fd, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, KD_MAGIC, sizeof(header.magic)) != 0 ||
+        (size_t)info.st_size < sizeof(kdheader) + sizeof(kdnode) * header.capacity) {
+        fprintf(stderr, "[%s] ERROR: %s is not a cpair index\n", process, path);
+        close(index->fd);
+        return -1;
+    }
+
+    kdmap(index, header.capacity, process);
+    return 0;
+}
+
+void kdclose(kdindex *index) {
+    if (index->header != NULL) {
+        if (index->writable) {
+            msync(index->header, index->mapped, MS_SYNC);
+        }
+        munmap(index->header, index->mapped);
+    }
+    close(index->fd);
+    memset(index, 0, sizeof(kdindex));
+    index->fd = -1;
+}
+
+/**
+ * @brief Looks up the indexed point closest to a probe.
+ * @param index The index.
+ * @param probe The point you intend to find the nearest neighbour of.
+ * @param result &mut The nearest indexed point.
+ * @param stack &mut A growable stack reused between lookups.
+ * @param capacity &mut The capacity of the stack.
+ * @param process The name of the current process.
+ * @return The squared distance to the nearest point, INFINITY if the index is empty.
+ */
+static float kdlookup(const kdindex *index, point probe, point *result, kdentry **stack, size_t *capacity,
+                      const char *process) {
+    float bestSq = INFINITY;
+    if (index->header->root == KD_NONE) {
+        return bestSq;
+    }
+
+    size_t stored = 0;
+    (*stack)[stored++] = (kdentry){.node = index->header->root, .depth = 0, .boundSq = 0.0f};
+
+    while (stored > 0) {
+        kdentry entry = (*stack)[--stored];
+        if (entry.boundSq >= bestSq) {
+            continue;
+        }
+
+        const kdnode *node = &index->nodes[entry.node];
+        float distance = sqdistance(probe, node->p);
+        if (distance < bestSq) {
+            bestSq = distance;
+            *result = node->p;
+        }
+
+        float diff = kdcoordinate(probe, entry.depth) - kdcoordinate(node->p, entry.depth);
+        uint32_t nearChild = (diff <= 0.0f) ? node->left : node->right;
+        uint32_t farChild = (diff <= 0.0f) ? node->right : node->left;
+
+        if (stored + 2 > *capacity) {
+            *capacity *= 2;
+            kdentry *tmp = realloc(*stack, sizeof(kdentry) * *capacity);
+            if (tmp == NULL) {
+                error("Failed to allocate memory", process);
+            }
+            *stack = tmp;
+        }
+
+        // The near child is pushed last so that it is searched first
+        if (farChild != KD_NONE) {
+            (*stack)[stored++] = (kdentry){.node = farChild, .depth = entry.depth + 1, .boundSq = diff * diff};
+        }
+        if (nearChild != KD_NONE) {
+            (*stack)[stored++] = (kdentry){.node = nearChild, .depth = entry.depth + 1, .boundSq = 0.0f};
+        }
+    }
+
+    return bestSq;
+}
+
+/**
+ * @brief Makes sure the index has room for more nodes, remapping it if it has to grow.
+ */
+static void kdreserve(kdindex *index, size_t more, const char *process) {
+    size_t needed = index->header->stored + more;
+    if (needed <= index->header->capacity) {
+        return;
+    }
+
+    if (needed > KD_NONE) {
+        error("The index cannot hold that many points", process);
+    }
+
+    size_t capacity = index->header->capacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    capacity = (capacity > KD_NONE) ? KD_NONE : capacity;
+
+    kdmap(index, capacity, process);
+    index->header->capacity = capacity;
+}
+
+/**
+ * @brief Moves the median of points[from..to) on the axis of the given depth to position middle.
+ */
+static void kdselect(point *points, size_t from, size_t to, size_t middle, uint32_t depth) {
+    while (to - from > 1) {
+        float pivot = kdcoordinate(points[from + (to - from) / 2], depth);
+        size_t i = from;
+        size_t lt = from;
+        size_t gt = to;
+
+        // Three way partition into < pivot, == pivot and > pivot
+        while (i < gt) {
+            float c = kdcoordinate(points[i], depth);
+            if (c < pivot) {
+                point tmp = points[lt];
+                points[lt++] = points[i];
+                points[i++] = tmp;
+            } else if (c > pivot) {
+                point tmp = points[--gt];
+                points[gt] = points[i];
+                points[i] = tmp;
+            } else {
+                i++;
+            }
+        }
+
+        if (middle < lt) {
+            to = lt;
+        } else if (middle >= gt) {
+            from = gt;
+        } else {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Builds a balanced tree over points[from..to).
+ * @details The node of points[i] is slots[i], or simply i if slots is NULL.
+ * @return The root of the subtree.
+ */
+static uint32_t kdbuild(kdnode *nodes, const uint32_t *slots, point *points, size_t from, size_t to,
+                        uint32_t depth) {
+    if (from >= to) {
+        return KD_NONE;
+    }
+
+    size_t middle = from + (to - from) / 2;
+    kdselect(points, from, to, middle, depth);
+
+    uint32_t id = (slots != NULL) ? slots[middle] : (uint32_t)middle;
+    uint32_t left = kdbuild(nodes, slots, points, from, middle, depth + 1);
+    uint32_t right = kdbuild(nodes, slots, points, middle + 1, to, depth + 1);
+
+    kdnode *node = &nodes[id];
+    node->p = points[middle];
+    node->left = left;
+    node->right = right;
+    return id;
+}
+
+/**
+ * @brief Makes sure a growable array of node ids has room for one more entry.
+ */
+static void kdpush(uint32_t **ids, size_t stored, size_t *capacity, const char *process) {
+    if (stored < *capacity) {
+        return;
+    }
+
+    *capacity *= 2;
+    uint32_t *tmp = realloc(*ids, sizeof(uint32_t) * *capacity);
+    if (tmp == NULL) {
+        error("Failed to allocate memory", process);
+    }
+    *ids = tmp;
+}
+
+/**
+ * @brief Collects the node ids of a subtree.
+ * @param ids &mut An array with room for the whole subtree, or NULL to only count it.
+ * @return The amount of nodes in the subtree.
+ */
+static size_t kdcollect(const kdnode *nodes, uint32_t subtree, uint32_t *ids, const char *process) {
+    if (subtree == KD_NONE) {
+        return 0;
+    }
+
+    size_t capacity = 64;
+    uint32_t *stack = malloc(sizeof(uint32_t) * capacity);
+    if (stack == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    size_t stored = 0;
+    size_t count = 0;
+    stack[stored++] = subtree;
+
+    while (stored > 0) {
+        uint32_t id = stack[--stored];
+        if (ids != NULL) {
+            ids[count] = id;
+        }
+        count++;
+
+        kdpush(&stack, stored + 1, &capacity, process);
+        if (nodes[id].left != KD_NONE) {
+            stack[stored++] = nodes[id].left;
+        }
+        if (nodes[id].right != KD_NONE) {
+            stack[stored++] = nodes[id].right;
+        }
+    }
+
+    free(stack);
+    return count;
+}
+
+/**
+ * @brief Rebuilds a subtree balanced, reusing its nodes.
+ * @param link &mut The child pointer (or root) that refers to the subtree.
+ * @param depth The depth of the subtree's root.
+ * @param size The amount of nodes in the subtree.
+ */
+static void kdrebuild(kdindex *index, uint32_t *link, uint32_t depth, size_t size, const char *process) {
+    uint32_t *slots = malloc(sizeof(uint32_t) * size);
+    point *points = malloc(sizeof(point) * size);
+    if (slots == NULL || points == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    kdcollect(index->nodes, *link, slots, process);
+    for (size_t i = 0; i < size; i++) {
+        points[i] = index->nodes[slots[i]].p;
+    }
+
+    *link = kdbuild(index->nodes, slots, points, 0, size, depth);
+
+    free(slots);
+    free(points);
+}
+
+/**
+ * @brief Inserts one point below the existing root, rebalancing like a scapegoat tree.
+ * @details If the new leaf ends up deeper than log(stored) / log(1 / KD_ALPHA), the lowest
+ * ancestor whose child on the path holds more than KD_ALPHA of its nodes is rebuilt balanced.
+ * Sorted input therefore keeps the depth logarithmic at amortized O(log^2 n) per insert.
+ * @param path &mut A growable array of node ids reused between inserts.
+ * @param capacity &mut The capacity of path.
+ */
+static void kdappend(kdindex *index, point p, uint32_t **path, size_t *capacity, const char *process) {
+    uint32_t id = (uint32_t)index->header->stored;
+    kdnode *node = &index->nodes[id];
+    node->p = p;
+    node->left = KD_NONE;
+    node->right = KD_NONE;
+    index->header->stored++;
+
+    if (index->header->root == KD_NONE) {
+        index->header->root = id;
+        return;
+    }
+
+    size_t depth = 0;
+    uint32_t current = index->header->root;
+    for (;;) {
+        kdpush(path, depth, capacity, process);
+        (*path)[depth] = current;
+
+        kdnode *parent = &index->nodes[current];
+        uint32_t *child = (kdcoordinate(p, (uint32_t)depth) <= kdcoordinate(parent->p, (uint32_t)depth))
+                              ? &parent->left
+                              : &parent->right;
+        depth++;
+        if (*child == KD_NONE) {
+            *child = id;
+            break;
+        }
+        current = *child;
+    }
+
+    double limit = log((double)index->header->stored) / log(1.0 / KD_ALPHA);
+    if ((double)depth <= limit) {
+        return;
+    }
+
+    // Walk up from the new leaf, (*path)[depth - 1] is its parent
+    uint32_t below = id;
+    size_t belowSize = 1;
+    for (size_t i = depth; i-- > 0;) {
+        const kdnode *ancestor = &index->nodes[(*path)[i]];
+        uint32_t sibling = (ancestor->left == below) ? ancestor->right : ancestor->left;
+        size_t size = belowSize + 1 + kdcollect(index->nodes, sibling, NULL, process);
+
+        if ((double)belowSize > KD_ALPHA * (double)size) {
+            uint32_t *link = &index->header->root;
+            if (i > 0) {
+                kdnode *parent = &index->nodes[(*path)[i - 1]];
+                link = (parent->left == (*path)[i]) ? &parent->left : &parent->right;
+            }
+            kdrebuild(index, link, (uint32_t)i, size, process);
+            return;
+        }
+
+        below = (*path)[i];
+        belowSize = size;
+    }
+}
+
+void kdinsert(kdindex *index, point *points, size_t stored, const char *process) {
+    if (stored == 0) {
+        return;
+    }
+
+    kdreserve(index, stored, process);
+    kdheader *header = index->header;
+
+    // An empty index gets a balanced tree and its closest pair from the engine
+    if (header->stored == 0) {
+        point pair[2];
+        if (threadedcpair(points, stored, 1, stored + 1, pair, process) == 2) {
+            header->best[0] = pair[0];
+            header->best[1] = pair[1];
+            header->bestSq = sqdistance(pair[0], pair[1]);
+        }
+
+        header->root = kdbuild(index->nodes, NULL, points, 0, stored, 0);
+        header->stored = stored;
+        return;
+    }
+
+    size_t capacity = 64;
+    kdentry *stack = malloc(sizeof(kdentry) * capacity);
+    size_t pathCapacity = 64;
+    uint32_t *path = malloc(sizeof(uint32_t) * pathCapacity);
+    if (stack == NULL || path == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    for (size_t i = 0; i < stored; i++) {
+        point neighbour;
+        float distance = kdlookup(index, points[i], &neighbour, &stack, &capacity, process);
+        if (distance < header->bestSq) {
+            header->bestSq = distance;
+            header->best[0] = points[i];
+            header->best[1] = neighbour;
+        }
+        kdappend(index, points[i], &path, &pathCapacity, process);
+    }
+
+    free(stack);
+    free(path);
+}
+
+size_t kdclosest(const kdindex *index, point pair[2]) {
+    if (index->header->stored < 2) {
+        return 0;
+    }
+    pair[0] = index->header->best[0];
+    pair[1] = index->header->best[1];
+    return 2;
+}
+
+int kdnearest(const kdindex *index, point *probes, size_t stored, point *results, const char *process) {
+    if (index->header->root == KD_NONE) {
+        return -1;
+    }
+
+    size_t capacity = 64;
+    kdentry *stack = malloc(sizeof(kdentry) * capacity);
+    if (stack == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    for (size_t i = 0; i < stored; i++) {
+        kdlookup(index, probes[i], &results[i], &stack, &capacity, process);
+    }
+
+    free(stack);
+    return 0;
+}
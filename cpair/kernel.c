@@ -0,0 +1,222 @@
+/**
+ * @file kernel.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief Squared distance kernels comparing one point against a block of candidates.
+ * @details The candidates are stored as separate x and y arrays so that 8 (AVX2) or 4 (SSE2)
+ * of them can be loaded at once. The AVX2 version is picked at runtime if the CPU supports it,
+ * so the binary still runs on machines without it. Points with more dimensions are stored
+ * as rows of coordinates instead, their kernel vectorizes across the dimensions of one pair.
+ **/
+
+#include "math.h"
+#include "stdint.h"
+#include "cpair.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include "immintrin.h"
+#define CPAIR_X86 (1)
+#endif
+
+/**
+ * @brief Scalar version of nearest, also used for the tails of the vector versions.
+ */
+static float nearestscalar(float px, float py, const float *x, const float *y, size_t count, size_t *index,
+                           float best, size_t bestIndex) {
+    for (size_t i = 0; i < count; i++) {
+        float dx = x[i] - px;
+        float dy = y[i] - py;
+        float distance = dx * dx + dy * dy;
+        if (distance < best) {
+            best = distance;
+            bestIndex = i;
+        }
+    }
+    *index = bestIndex;
+    return best;
+}
+
+#ifdef CPAIR_X86
+
+/**
+ * @brief SSE2 version of nearest, SSE2 is part of every x86-64 CPU.
+ */
+__attribute__((target("sse2")))
+static float nearestsse(float px, float py, const float *x, const float *y, size_t count, size_t *index) {
+    if (count < 4) {
+        return nearestscalar(px, py, x, y, count, index, INFINITY, 0);
+    }
+
+    __m128 vpx = _mm_set1_ps(px);
+    __m128 vpy = _mm_set1_ps(py);
+    __m128 vbest = _mm_set1_ps(INFINITY);
+    __m128i vbestIndex = _mm_setzero_si128();
+    __m128i vindex = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i vstep = _mm_set1_epi32(4);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), vpx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), vpy);
+        __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+        __m128 closer = _mm_cmplt_ps(distance, vbest);
+        vbest = _mm_or_ps(_mm_and_ps(closer, distance), _mm_andnot_ps(closer, vbest));
+        __m128i closerIndex = _mm_castps_si128(closer);
+        vbestIndex = _mm_or_si128(_mm_and_si128(closerIndex, vindex), _mm_andnot_si128(closerIndex, vbestIndex));
+        vindex = _mm_add_epi32(vindex, vstep);
+    }
+
+    float lanes[4];
+    int laneIndices[4];
+    _mm_storeu_ps(lanes, vbest);
+    _mm_storeu_si128((__m128i *)laneIndices, vbestIndex);
+
+    float best = lanes[0];
+    size_t bestIndex = (size_t)laneIndices[0];
+    for (int lane = 1; lane < 4; lane++) {
+        if (lanes[lane] < best || (lanes[lane] == best && (size_t)laneIndices[lane] < bestIndex)) {
+            best = lanes[lane];
+            bestIndex = (size_t)laneIndices[lane];
+        }
+    }
+
+    size_t tailIndex;
+    float tail = nearestscalar(px, py, x + i, y + i, count - i, &tailIndex, best, SIZE_MAX);
+    *index = (tail < best) ? i + tailIndex : bestIndex;
+    return tail;
+}
+
+/**
+ * @brief AVX2 version of nearest.
+ */
+__attribute__((target("avx2")))
+static float nearestavx(float px, float py, const float *x, const float *y, size_t count, size_t *index) {
+    if (count < 8) {
+        return nearestsse(px, py, x, y, count, index);
+    }
+
+    __m256 vpx = _mm256_set1_ps(px);
+    __m256 vpy = _mm256_set1_ps(py);
+    __m256 vbest = _mm256_set1_ps(INFINITY);
+    __m256i vbestIndex = _mm256_setzero_si256();
+    __m256i vindex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i vstep = _mm256_set1_epi32(8);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), vpx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), vpy);
+        __m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+        __m256 closer = _mm256_cmp_ps(distance, vbest, _CMP_LT_OQ);
+        vbest = _mm256_blendv_ps(vbest, distance, closer);
+        vbestIndex = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(vbestIndex),
+                                                          _mm256_castsi256_ps(vindex), closer));
+        vindex = _mm256_add_epi32(vindex, vstep);
+    }
+
+    float lanes[8];
+    int laneIndices[8];
+    _mm256_storeu_ps(lanes, vbest);
+    _mm256_storeu_si256((__m256i *)laneIndices, vbestIndex);
+
+    float best = lanes[0];
+    size_t bestIndex = (size_t)laneIndices[0];
+    for (int lane = 1; lane < 8; lane++) {
+        if (lanes[lane] < best || (lanes[lane] == best && (size_t)laneIndices[lane] < bestIndex)) {
+            best = lanes[lane];
+            bestIndex = (size_t)laneIndices[lane];
+        }
+    }
+
+    size_t tailIndex;
+    float tail = nearestscalar(px, py, x + i, y + i, count - i, &tailIndex, best, SIZE_MAX);
+    *index = (tail < best) ? i + tailIndex : bestIndex;
+    return tail;
+}
+
+/**
+ * @brief SSE2 version of sqdistancen.
+ */
+__attribute__((target("sse2")))
+static float sqdistancensse(const float *a, const float *b, size_t dimension) {
+    __m128 sum = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= dimension; i += 4) {
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        sum = _mm_add_ps(sum, _mm_mul_ps(diff, diff));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    float distance = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < dimension; i++) {
+        float diff = a[i] - b[i];
+        distance += diff * diff;
+    }
+    return distance;
+}
+
+/**
+ * @brief AVX2 version of sqdistancen.
+ */
+__attribute__((target("avx2")))
+static float sqdistancenavx(const float *a, const float *b, size_t dimension) {
+    if (dimension < 8) {
+        return sqdistancensse(a, b, dimension);
+    }
+
+    __m256 sum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= dimension; i += 8) {
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(diff, diff));
+    }
+
+    float lanes[8];
+    _mm256_storeu_ps(lanes, sum);
+    float distance = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    for (; i < dimension; i++) {
+        float diff = a[i] - b[i];
+        distance += diff * diff;
+    }
+    return distance;
+}
+
+/**
+ * @brief Checks once whether the CPU supports AVX2.
+ */
+static int hasavx2(void) {
+    static int hasAvx2 = -1;
+    int avx2 = __atomic_load_n(&hasAvx2, __ATOMIC_RELAXED);
+    if (avx2 == -1) {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&hasAvx2, avx2, __ATOMIC_RELAXED);
+    }
+    return avx2;
+}
+
+#endif
+
+float nearest(float px, float py, const float *x, const float *y, size_t count, size_t *index) {
+#ifdef CPAIR_X86
+    return hasavx2() ? nearestavx(px, py, x, y, count, index) : nearestsse(px, py, x, y, count, index);
+#else
+    return nearestscalar(px, py, x, y, count, index, INFINITY, 0);
+#endif
+}
+
+float sqdistancen(const float *a, const float *b, size_t dimension) {
+#ifdef CPAIR_X86
+    return hasavx2() ? sqdistancenavx(a, b, dimension) : sqdistancensse(a, b, dimension);
+#else
+    float distance = 0.0f;
+    for (size_t i = 0; i < dimension; i++) {
+        float diff = a[i] - b[i];
+        distance += diff * diff;
+    }
+    return distance;
+#endif
+}
@@ -0,0 +1,372 @@
+/**
+ * @file loader.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief Bulk loading of text points.
+ * @details Regular files are mapped into memory, everything else (pipes, terminals) is read in large blocks.
+ * The whole input is then parsed in place without copying lines, after the point array
+ * has been sized from the amount of newlines. The parser is instantiated from scanpoints.h,
+ * the -p specializations instantiate it for their own coordinate types.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "stdint.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "cpair.h"
+
+/**
+ * Size of the blocks that are read from inputs that cannot be mapped.
+ */
+#define BLOCK_SIZE (1 << 20)
+
+/**
+ * Mantissas with more digits than this do not fit into a uint64_t and are left to strtof.
+ */
+#define MAX_DIGITS (19)
+
+/**
+ * Doubles represent every integer up to this exactly, larger mantissas are left to strtod.
+ */
+#define MAX_EXACT_MANTISSA (UINT64_C(1) << 53)
+
+/**
+ * Floats represent every integer up to this exactly, larger mantissas are left to strtof.
+ */
+#define MAX_EXACT_MANTISSA_FLOAT (UINT64_C(1) << 24)
+
+/**
+ * The powers of ten up to 1e10 are exact floats, larger ones are left to strtof.
+ */
+static const float powersf[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const double powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief Checks whether a character separates the two coordinates of a line.
+ */
+static int isblankchar(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * Tokens shorter than this are copied to the stack, longer ones to the heap.
+ */
+#define TOKEN_SIZE (128)
+
+/**
+ * @brief Copies a token into a NUL terminated buffer, for all inputs the fast path does not handle.
+ * @details The token is copied because the input is not NUL terminated.
+ * @param start The first character of the token.
+ * @param end The character after the token.
+ * @param token A buffer of TOKEN_SIZE characters.
+ * @return token if the token fits into it, otherwise a malloc'd copy, NULL if the token is empty.
+ */
+static char *copytoken(const char *start, const char *end, char token[TOKEN_SIZE]) {
+    size_t length = (size_t)(end - start);
+
+    if (length == 0) {
+        return NULL;
+    }
+
+    char *copy = token;
+    if (length >= TOKEN_SIZE && (copy = malloc(length + 1)) == NULL) {
+        // The scanners do not know the name of the process, this only happens when memory is exhausted anyway
+        error("Failed to allocate memory", "cpair");
+    }
+
+    memcpy(copy, start, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/**
+ * @brief Parses a float with strtof, for all inputs the fast path does not handle.
+ * @return 0 if the whole token is a valid float, -1 otherwise.
+ */
+static int slowfloat(const char *start, const char *end, float *value) {
+    char buffer[TOKEN_SIZE];
+    char *token = copytoken(start, end, buffer);
+    if (token == NULL) {
+        return -1;
+    }
+
+    char *endptr;
+    *value = strtof(token, &endptr);
+    int result = (*endptr == '\0') ? 0 : -1;
+    if (token != buffer) {
+        free(token);
+    }
+    return result;
+}
+
+/**
+ * @brief Parses a double with strtod, for all inputs the fast path does not handle.
+ * @return 0 if the whole token is a valid double, -1 otherwise.
+ */
+static int slowdouble(const char *start, const char *end, double *value) {
+    char buffer[TOKEN_SIZE];
+    char *token = copytoken(start, end, buffer);
+    if (token == NULL) {
+        return -1;
+    }
+
+    char *endptr;
+    *value = strtod(token, &endptr);
+    int result = (*endptr == '\0') ? 0 : -1;
+    if (token != buffer) {
+        free(token);
+    }
+    return result;
+}
+
+/**
+ * @brief The result of scanning a decimal number without calling into libc.
+ */
+typedef struct {
+    const char *end;
+    const char *tokenEnd;
+    uint64_t mantissa;
+    int digits;
+    int exponent;
+    int negative;
+} decimal;
+
+/**
+ * @brief Scans the decimal number at start.
+ * @details Handles an optional sign, digits, an optional fraction and an optional exponent.
+ * The number is only usable if the caller's fast path accepts it, see scanfloat.
+ * @param start The first character of the token.
+ * @param end The end of the input.
+ * @return The parts of the number, end is where scanning stopped and tokenEnd where the token ends.
+ */
+static decimal scandecimal(const char *start, const char *end) {
+    const char *c = start;
+
+    int negative = 0;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = (*c == '-');
+        c++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    while (c < end && (unsigned)(*c - '0') < 10) {
+        mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+        digits++;
+        c++;
+    }
+
+    if (c < end && *c == '.') {
+        c++;
+        while (c < end && (unsigned)(*c - '0') < 10) {
+            mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+            digits++;
+            exponent--;
+            c++;
+        }
+    }
+
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        c++;
+        int exponentNegative = 0;
+        if (c < end && (*c == '-' || *c == '+')) {
+            exponentNegative = (*c == '-');
+            c++;
+        }
+
+        int explicitExponent = 0;
+        int exponentDigits = 0;
+        while (c < end && (unsigned)(*c - '0') < 10 && explicitExponent < 10000) {
+            explicitExponent = explicitExponent * 10 + (*c - '0');
+            exponentDigits++;
+            c++;
+        }
+
+        if (exponentDigits == 0) {
+            digits = 0;
+        }
+        exponent += exponentNegative ? -explicitExponent : explicitExponent;
+    }
+
+    // Find the end of the token to decide whether the fast path understood all of it
+    const char *tokenEnd = c;
+    while (tokenEnd < end && *tokenEnd != '\n' && !isblankchar(*tokenEnd)) {
+        tokenEnd++;
+    }
+
+    decimal d = {
+        .end = c, .tokenEnd = tokenEnd, .mantissa = mantissa, .digits = digits, .exponent = exponent,
+        .negative = negative
+    };
+    return d;
+}
+
+/**
+ * @brief Checks whether the fast path understood all of a scanned number.
+ */
+static int fastdecimal(const decimal *d) {
+    int maxExponent = (int)(sizeof(powers) / sizeof(powers[0])) - 1;
+    return d->digits != 0 && d->digits <= MAX_DIGITS && d->tokenEnd == d->end &&
+           d->exponent <= maxExponent && d->exponent >= -maxExponent;
+}
+
+/**
+ * @brief Returns the value of a number the fast path understood.
+ */
+static double decimalvalue(const decimal *d) {
+    double result = (double)d->mantissa;
+    result = (d->exponent < 0) ? result / powers[-d->exponent] : result * powers[d->exponent];
+    return d->negative ? -result : result;
+}
+
+int scanfloat(const char **cursor, const char *end, float *value) {
+    decimal d = scandecimal(*cursor, end);
+    // Both the mantissa and the power of ten are exact floats, so one float division or multiplication
+    // rounds correctly. Going through double would round twice and could differ from strtof.
+    int maxExponent = (int)(sizeof(powersf) / sizeof(powersf[0])) - 1;
+    if (!fastdecimal(&d) || d.mantissa > MAX_EXACT_MANTISSA_FLOAT || d.exponent > maxExponent ||
+        d.exponent < -maxExponent) {
+        const char *start = *cursor;
+        *cursor = d.tokenEnd;
+        return slowfloat(start, d.tokenEnd, value);
+    }
+
+    float result = (float)d.mantissa;
+    result = (d.exponent < 0) ? result / powersf[-d.exponent] : result * powersf[d.exponent];
+    *value = d.negative ? -result : result;
+    *cursor = d.end;
+    return 0;
+}
+
+int scandouble(const char **cursor, const char *end, double *value) {
+    decimal d = scandecimal(*cursor, end);
+    // Both the mantissa and the power of ten are exact doubles, so one division or multiplication rounds correctly
+    if (!fastdecimal(&d) || d.mantissa > MAX_EXACT_MANTISSA) {
+        const char *start = *cursor;
+        *cursor = d.tokenEnd;
+        return slowdouble(start, d.tokenEnd, value);
+    }
+
+    *value = decimalvalue(&d);
+    *cursor = d.end;
+    return 0;
+}
+
+#define SCANPOINTS parsepoints
+#define SCANPOINT point
+#define PARSE(cursor, end, value) scanfloat(cursor, end, value)
+#include "scanpoints.h"
+#undef SCANPOINTS
+#undef SCANPOINT
+#undef PARSE
+
+/**
+ * @brief Reads everything from a file descriptor into one buffer, block by block.
+ * @param fd The file descriptor you intend to read from.
+ * @param size &mut The amount of bytes read.
+ * @param process The name of the current process.
+ * @return The buffer, which has to be freed by the caller.
+ */
+static char *readblocks(int fd, size_t *size, const char *process) {
+    size_t capacity = BLOCK_SIZE;
+    size_t stored = 0;
+    char *buffer = malloc(capacity);
+
+    if (buffer == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    for (;;) {
+        if (capacity - stored < BLOCK_SIZE) {
+            capacity *= 2;
+            char *tmp = realloc(buffer, capacity);
+            if (tmp == NULL) {
+                free(buffer);
+                error("Failed to allocate memory", process);
+            }
+            buffer = tmp;
+        }
+
+        ssize_t got = read(fd, buffer + stored, capacity - stored);
+        if (got == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(buffer);
+            error("Error reading input", process);
+        }
+        if (got == 0) {
+            break;
+        }
+        stored += (size_t)got;
+    }
+
+    *size = stored;
+    return buffer;
+}
+
+void textopen(int fd, textinput *text, const char *process) {
+    struct stat info;
+
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = (size_t)info.st_size;
+        char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED) {
+            madvise(data, size, MADV_SEQUENTIAL);
+            text->data = data;
+            text->size = size;
+            text->mapped = 1;
+            return;
+        }
+    }
+
+    text->data = readblocks(fd, &text->size, process);
+    text->mapped = 0;
+}
+
+void textclose(textinput *text) {
+    if (text->mapped) {
+        munmap(text->data, text->size);
+    } else {
+        free(text->data);
+    }
+    text->data = NULL;
+}
+
+ssize_t loadpoints(int fd, point **points, const char *process) {
+    textinput text;
+    textopen(fd, &text, process);
+    ssize_t stored = parsepoints(text.data, text.size, points, process);
+    textclose(&text);
+    return stored;
+}
+
+int openinput(const char *path, const char *process) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "[%s] ERROR: Cannot open %s: %s\n", process, path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+ssize_t filetopa(const char *path, point **points, const char *process) {
+    int fd = openinput(path, process);
+
+    ssize_t stored = loadpoints(fd, points, process);
+    close(fd);
+    return stored;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file pointgen.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief Generates synthetic point sets for benchmarking cpair.
+ **/
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdint.h"
+#include "errno.h"
+#include "limits.h"
+#include "unistd.h"
+#include "math.h"
+
+/**
+ * Points are generated inside [0, EXTENT) on both axes.
+ */
+#define EXTENT (1000000.0)
+
+/**
+ * @brief Print a usage message to stderr and exit the process with EXIT_FAILURE.
+ * @param process The name of the current process.
+ */
+void usage(const char *process) {
+    fprintf(stderr, "[%s] USAGE: %s [-d uniform|clustered|collinear|duplicates] [-s SEED] COUNT\n", process, process);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Parses an unsigned number from a string.
+ * @param str The string you intend to convert.
+ * @param value &mut The parsed value.
+ * @return 0 if successful -1 otherwise
+ */
+int parsecount(const char *str, unsigned long long *value) {
+    errno = 0;
+    char *endptr;
+    unsigned long long result = strtoull(str, &endptr, 10);
+
+    if (errno != 0 || endptr == str || *endptr != '\0' || str[0] == '-') {
+        return -1;
+    }
+
+    *value = result;
+    return 0;
+}
+
+/**
+ * @brief A xorshift generator, so every seed always gives the same points.
+ * @param state &mut The state of the generator, must not be 0.
+ * @return A uniformly distributed value in [0, 1).
+ */
+double uniform(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (double)(x >> 11) / 9007199254740992.0;
+}
+
+/**
+ * @brief Returns a normally distributed value (Box-Muller).
+ * @param state &mut The state of the generator.
+ */
+double gaussian(uint64_t *state) {
+    double u1 = uniform(state);
+    double u2 = uniform(state);
+    return sqrt(-2.0 * log(u1 + 1e-300)) * cos(2.0 * M_PI * u2);
+}
+
+/**
+ * @brief The entrypoint of the program.
+ * @param argc
+ * @param argv
+ * @return EXIT_SUCCESS if everything worked fine else EXIT_FAILURE
+ */
+int main(int argc, char *argv[]) {
+    const char *process = argv[0];
+    const char *distribution = "uniform";
+    unsigned long long seed = 1;
+
+    int option;
+    while ((option = getopt(argc, argv, "d:s:")) != -1) {
+        switch (option) {
+            case 'd':
+                distribution = optarg;
+                break;
+            case 's':
+                if (parsecount(optarg, &seed) == -1) {
+                    usage(process);
+                }
+                break;
+            default:
+                usage(process);
+        }
+    }
+
+    unsigned long long count;
+    if (argc - optind != 1 || parsecount(argv[optind], &count) == -1) {
+        usage(process);
+    }
+
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 0x2545F4914F6CDD1DULL;
+    state = (state == 0) ? 1 : state;
+
+    if (strcmp(distribution, "uniform") == 0) {
+        for (unsigned long long i = 0; i < count; i++) {
+            printf("%.3f %.3f\n", uniform(&state) * EXTENT, uniform(&state) * EXTENT);
+        }
+    } else if (strcmp(distribution, "clustered") == 0) {
+        // About sqrt(n) gaussian blobs, each a thousandth of the extent wide
+        unsigned long long clusters = (unsigned long long)sqrt((double)count) + 1;
+        double *centers = malloc(sizeof(double) * 2 * clusters);
+        if (centers == NULL) {
+            fprintf(stderr, "[%s] ERROR: Failed to allocate memory\n", process);
+            exit(EXIT_FAILURE);
+        }
+        for (unsigned long long c = 0; c < clusters; c++) {
+            centers[2 * c] = uniform(&state) * EXTENT;
+            centers[2 * c + 1] = uniform(&state) * EXTENT;
+        }
+        for (unsigned long long i = 0; i < count; i++) {
+            unsigned long long c = (unsigned long long)(uniform(&state) * (double)clusters);
+            printf("%.3f %.3f\n",
+                   centers[2 * c] + gaussian(&state) * EXTENT / 1000.0,
+                   centers[2 * c + 1] + gaussian(&state) * EXTENT / 1000.0);
+        }
+        free(centers);
+    } else if (strcmp(distribution, "collinear") == 0) {
+        // Two columns one unit apart around x = EXTENT / 2. The median split of the process tree, -w and -m
+        // lands on one of them and the mean split of the in-process engine (-t, the leaves of -d, -p) between them,
+        // so as long as the points of a column are more than one unit apart the first strip holds the whole input
+        for (unsigned long long i = 0; i < count; i++) {
+            printf("%.3f %.3f\n", EXTENT / 2.0 + ((i % 2 == 0) ? -0.5 : 0.5), uniform(&state) * EXTENT);
+        }
+    } else if (strcmp(distribution, "duplicates") == 0) {
+        // Every point is one of count / 10 distinct points
+        unsigned long long distinct = count / 10 + 1;
+        for (unsigned long long i = 0; i < count; i++) {
+            uint64_t pick = (uint64_t)(uniform(&state) * (double)distinct) * 0x9E3779B97F4A7C15ULL + 1;
+            printf("%.3f %.3f\n", uniform(&pick) * EXTENT, uniform(&pick) * EXTENT);
+        }
+    } else {
+        usage(process);
+    }
+
+    if (fflush(stdout) == EOF) {
+        fprintf(stderr, "[%s] ERROR: Error writing to file\n", process);
+        exit(EXIT_FAILURE);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file precision.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The closest pair engine specialized for double and fixed point coordinates.
+ * @details closest.h instantiates the engine of engine.h once per coordinate type, so every specialization
+ * compares its own native type and the choice between them is a single switch. float is the engine of engine.c.
+ * Fixed point coordinates are int64 counts of millionths with squared distances in 128 bits, which makes
+ * every comparison exact and equal coordinates really equal.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "stdint.h"
+#include "ctype.h"
+#include "math.h"
+#include "cpair.h"
+#include "threadpool.h"
+
+/**
+ * Fixed point coordinates keep this many decimal digits.
+ */
+#define FIXED_DIGITS (6)
+#define FIXED_SCALE (1000000)
+
+/**
+ * Fixed point coordinates must stay within +-FIXED_LIMIT, so that differences fit into int64
+ * and the sum of two squared differences fits into 128 bits.
+ */
+#define FIXED_LIMIT (INT64_C(1) << 62)
+
+/**
+ * Mantissas stop taking digits at this size, so that 19 significant digits always fit into a uint64_t.
+ */
+#define FIXED_MAX_MANTISSA (UINT64_C(1000000000000000000))
+
+/**
+ * Mantissas have at most 19 digits, so rounding away more than this many always leaves 0.
+ */
+#define FIXED_MAX_SHIFT (19)
+
+__extension__ typedef unsigned __int128 fixedsq;
+__extension__ typedef __int128 fixedsum;
+
+/**
+ * @brief Parses a decimal number to a fixed point value, bounded by end.
+ * @details Takes the same decimals as the loader: an optional sign, digits, an optional fraction
+ * and an optional exponent. Digits beyond FIXED_DIGITS are rounded half away from zero.
+ * @param str The first character of the number.
+ * @param end The end of the input.
+ * @param endptr &mut Where parsing stopped.
+ * @param value &mut The parsed value.
+ * @return 0 if successful, -1 if there is no such decimal at str and -2 if it is outside of FIXED_LIMIT.
+ */
+static int strtofixed(const char *str, const char *end, const char **endptr, int64_t *value) {
+    const char *c = str;
+    int negative = 0;
+    if (c < end && (*c == '+' || *c == '-')) {
+        negative = (*c == '-');
+        c++;
+    }
+
+    // The number is mantissa * 10^exponent, digits that do not fit into the mantissa only move the exponent
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    int fraction = 0;
+    for (; c < end; c++) {
+        if (*c == '.' && !fraction) {
+            fraction = 1;
+            continue;
+        }
+        if (!isdigit((unsigned char)*c)) {
+            break;
+        }
+        digits++;
+        if (mantissa < FIXED_MAX_MANTISSA) {
+            mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+            exponent -= fraction;
+        } else {
+            exponent += !fraction;
+        }
+    }
+    if (digits == 0) {
+        return -1;
+    }
+
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        c++;
+        int exponentNegative = 0;
+        if (c < end && (*c == '+' || *c == '-')) {
+            exponentNegative = (*c == '-');
+            c++;
+        }
+
+        int explicitExponent = 0;
+        int exponentDigits = 0;
+        while (c < end && isdigit((unsigned char)*c)) {
+            explicitExponent = (explicitExponent < 10000) ? explicitExponent * 10 + (*c - '0') : explicitExponent;
+            exponentDigits++;
+            c++;
+        }
+        if (exponentDigits == 0) {
+            return -1;
+        }
+        exponent += exponentNegative ? -explicitExponent : explicitExponent;
+    }
+    *endptr = c;
+
+    if (mantissa == 0) {
+        *value = 0;
+        return 0;
+    }
+
+    // Scale the mantissa to millionths, rounding away whatever is below them
+    int shift = exponent + FIXED_DIGITS;
+    for (; shift > 0; shift--) {
+        if (mantissa > (uint64_t)FIXED_LIMIT / 10) {
+            return -2;
+        }
+        mantissa *= 10;
+    }
+    if (shift < -FIXED_MAX_SHIFT) {
+        mantissa = 0;
+    } else if (shift < 0) {
+        uint64_t divisor = 1;
+        for (; shift < 0; shift++) {
+            divisor *= 10;
+        }
+        uint64_t remainder = mantissa % divisor;
+        mantissa = mantissa / divisor + ((remainder >= divisor - remainder) ? 1 : 0);
+    }
+
+    if (mantissa > (uint64_t)FIXED_LIMIT) {
+        return -2;
+    }
+    *value = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+    return 0;
+}
+
+/**
+ * @brief Scans one fixed point value starting at *cursor and advances the cursor past it.
+ * @details Whatever the loader takes but strtofixed does not (inf, nan, hex floats) is scanned as a double,
+ * so an input is valid in every mode as long as its values fit.
+ * @return 0 if successful -1 if the token at the cursor is not a valid fixed point value.
+ */
+static int scanfixed(const char **cursor, const char *end, int64_t *value) {
+    const char *c = *cursor;
+    int result = strtofixed(*cursor, end, &c, value);
+    if (result == 0 && (c >= end || *c == '\n' || *c == ' ' || *c == '\t' || *c == '\r')) {
+        *cursor = c;
+        return 0;
+    }
+    if (result == -2) {
+        return -1;
+    }
+
+    double scanned;
+    if (scandouble(cursor, end, &scanned) == -1 || !(fabs(scanned) * FIXED_SCALE <= (double)FIXED_LIMIT)) {
+        return -1;
+    }
+    *value = llround(scanned * FIXED_SCALE);
+    return 0;
+}
+
+/**
+ * @brief Prints a fixed point value with all of its digits.
+ */
+static void printfixed(FILE *file, int64_t value) {
+    uint64_t magnitude = (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    fprintf(file, "%s%llu.%0*llu", (value < 0) ? "-" : "", (unsigned long long)(magnitude / FIXED_SCALE),
+            FIXED_DIGITS, (unsigned long long)(magnitude % FIXED_SCALE));
+}
+
+/**
+ * @brief Returns the squared difference of two fixed point values without any rounding.
+ */
+static fixedsq fixeddiffsq(int64_t a, int64_t b) {
+    uint64_t diff = (a > b) ? (uint64_t)a - (uint64_t)b : (uint64_t)b - (uint64_t)a;
+    return (fixedsq)diff * diff;
+}
+
+/**
+ * @brief Returns the squared radius of a query in fixed point.
+ * @details No two coordinates within FIXED_LIMIT are further apart than 1.5 * 2^63, beyond that every pair is within.
+ */
+static fixedsq fixedradiussq(const query *q) {
+    double radius = q->radius * FIXED_SCALE;
+    if (radius >= 1.5 * 2.0 * (double)FIXED_LIMIT) {
+        return ~(fixedsq)0;
+    }
+    uint64_t scaled = (uint64_t)(radius + 0.5);
+    return (fixedsq)scaled * scaled;
+}
+
+static double doublediffsq(double a, double b) {
+    double diff = a - b;
+    return diff * diff;
+}
+
+#define SUFFIX double
+#define COORD double
+#define DIST double
+#define SUM long double
+#define DIFFSQ(a, b) doublediffsq(a, b)
+#define RADIUSSQ(q) ((q)->radius * (q)->radius)
+#define PARSE(cursor, end, value) scandouble(cursor, end, value)
+#define PRINT(file, value) fprintf(file, "%.6f", value)
+#include "closest.h"
+#undef SUFFIX
+#undef COORD
+#undef DIST
+#undef SUM
+#undef DIFFSQ
+#undef RADIUSSQ
+#undef PARSE
+#undef PRINT
+
+#define SUFFIX fixed
+#define COORD int64_t
+#define DIST fixedsq
+#define SUM fixedsum
+#define DIFFSQ(a, b) fixeddiffsq(a, b)
+#define RADIUSSQ(q) fixedradiussq(q)
+#define PARSE(cursor, end, value) scanfixed(cursor, end, value)
+#define PRINT(file, value) printfixed(file, value)
+#include "closest.h"
+#undef SUFFIX
+#undef COORD
+#undef DIST
+#undef SUM
+#undef DIFFSQ
+#undef RADIUSSQ
+#undef PARSE
+#undef PRINT
+
+int parseprecision(const char *str, precision *value) {
+    if (strcmp(str, "float") == 0) {
+        *value = PRECISION_FLOAT;
+    } else if (strcmp(str, "double") == 0) {
+        *value = PRECISION_DOUBLE;
+    } else if (strcmp(str, "fixed") == 0) {
+        *value = PRECISION_FIXED;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+ssize_t precisecpair(precision type, int fd, FILE *output, size_t threads, size_t cutoff, const query *q,
+                     const char *process) {
+    if (type == PRECISION_FIXED) {
+        return cpairfixed(fd, output, threads, cutoff, q, process);
+    }
+    return cpairdouble(fd, output, threads, cutoff, q, process);
+}
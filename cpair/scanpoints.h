@@ -0,0 +1,76 @@
+/**
+ * @file scanpoints.h
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The parser of a buffer of text points for one coordinate type.
+ * @details This file has no include guard on purpose, it is included once per coordinate type after defining:
+ * - SCANPOINTS the name of the parser,
+ * - SCANPOINT the type of a point, with the coordinates x and y,
+ * - PARSE(cursor, end, value) scanning the coordinate at *cursor and moving the cursor past it
+ * (0 if successful -1 otherwise).
+ *
+ * loader.c instantiates it for point, closest.h for every coordinate type of precision.c.
+ **/
+
+#define SCANBLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r')
+
+/**
+ * @brief Parses a buffer of text points ("x y" separated by newlines) into a point array.
+ * @param data The text you intend to parse, it does not have to be NUL terminated.
+ * @param size The amount of bytes in data.
+ * @param points &mut A pointer to an UNINITIALISED point array.
+ * @param process The name of the current process.
+ * @return The amount of points parsed.
+ */
+static ssize_t SCANPOINTS(const char *data, size_t size, SCANPOINT **points, const char *process) {
+    const char *end = data + size;
+
+    // Every point ends with a newline, except maybe the last one
+    size_t capacity = 1;
+    for (const char *c = data; c < end && (c = memchr(c, '\n', (size_t)(end - c))) != NULL; c++) {
+        capacity++;
+    }
+
+    *points = malloc(sizeof(SCANPOINT) * capacity);
+    if (*points == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    ssize_t stored = 0;
+    const char *cursor = data;
+    while (cursor < end) {
+        SCANPOINT p;
+
+        while (cursor < end && SCANBLANK(*cursor)) {
+            cursor++;
+        }
+        if (PARSE(&cursor, end, &p.x) == -1 || cursor >= end || !SCANBLANK(*cursor)) {
+            free(*points);
+            error("Malformed input line", process);
+        }
+
+        while (cursor < end && SCANBLANK(*cursor)) {
+            cursor++;
+        }
+        if (PARSE(&cursor, end, &p.y) == -1) {
+            free(*points);
+            error("Malformed input line", process);
+        }
+
+        while (cursor < end && SCANBLANK(*cursor)) {
+            cursor++;
+        }
+        if (cursor < end && *cursor != '\n') {
+            free(*points);
+            error("Malformed input line", process);
+        }
+        cursor++;
+
+        (*points)[stored] = p;
+        stored++;
+    }
+
+    return stored;
+}
+
+#undef SCANBLANK
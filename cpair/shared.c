@@ -0,0 +1,97 @@
+/**
+ * @file shared.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief Hands the points of the process tree to the children through shared memory.
+ * @details The root moves its points into an unlinked POSIX shared memory object whose descriptor
+ * is inherited by every process of the tree. A child is only told which range of the array is its
+ * subproblem and maps the object itself, so points are never copied through pipes.
+ * The ranges of siblings are disjoint, which lets every process split its own range in place.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "inttypes.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "cpair.h"
+
+typedef struct {
+    void *base;
+    size_t size;
+} sharedregion;
+
+static sharedregion region = {.base = NULL, .size = 0};
+
+/**
+ * @brief Maps the whole shared memory object.
+ * @return The start of the points.
+ */
+static point *sharedmap(int fd, size_t size, const char *process) {
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        error("Cannot map the shared points", process);
+    }
+    region.base = base;
+    region.size = size;
+    return base;
+}
+
+point *sharedcreate(point *points, size_t stored, int *fd, const char *process) {
+    char name[64];
+    snprintf(name, sizeof(name), "/cpair-%ld", (long)getpid());
+
+    *fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (*fd == -1) {
+        fprintf(stderr, "[%s] ERROR: Cannot create shared memory: %s\n", process, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    // Only the descriptor is needed from now on, so nothing is left behind if the tree crashes
+    shm_unlink(name);
+
+    // shm_open sets close-on-exec, the descriptor has to survive into the children
+    size_t size = sizeof(point) * stored;
+    if (fcntl(*fd, F_SETFD, 0) == -1 || ftruncate(*fd, (off_t)size) == -1) {
+        error("Cannot create shared memory", process);
+    }
+
+    point *shared = sharedmap(*fd, size, process);
+    memcpy(shared, points, size);
+    free(points);
+    return shared;
+}
+
+ssize_t sharedopen(const char *spec, point **points, int *fd, const char *process) {
+    uintmax_t offset;
+    uintmax_t stored;
+    char end;
+    if (sscanf(spec, "%d:%" SCNuMAX ":%" SCNuMAX "%c", fd, &offset, &stored, &end) != 3) {
+        error("Malformed shared memory range", process);
+    }
+
+    struct stat info;
+    if (fstat(*fd, &info) == -1 || offset > (uintmax_t)info.st_size / sizeof(point) ||
+        stored > (uintmax_t)info.st_size / sizeof(point) - offset) {
+        error("Malformed shared memory range", process);
+    }
+
+    point *shared = sharedmap(*fd, (size_t)info.st_size, process);
+    *points = shared + offset;
+    return (ssize_t)stored;
+}
+
+size_t sharedoffset(const point *points) {
+    return (size_t)(points - (const point *)region.base);
+}
+
+void releasepoints(point *points) {
+    if (region.base != NULL) {
+        munmap(region.base, region.size);
+        region.base = NULL;
+        return;
+    }
+    free(points);
+}
@@ -0,0 +1,224 @@
+/**
+ * @file stream.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The streaming closest pair mode.
+ * @details Keeps every point seen so far in a hash grid whose cells are as wide as the current
+ * closest distance delta. A new point can only be closer than delta to points in the 3x3 cells
+ * around it, so each arrival costs a constant amount of work, until delta shrinks and the grid
+ * is rebuilt with smaller cells. For points arriving in random order the rebuilds add up to
+ * expected O(n) (Golin et al.). Every point costs one point, one chain link and about two table slots.
+ **/
+
+#include "stdlib.h"
+#include "stdint.h"
+#include "string.h"
+#include "math.h"
+#include "cpair.h"
+
+#define STREAM_NONE (SIZE_MAX)
+
+/**
+ * Cell coordinates are clamped to this range, which keeps neighbouring points in neighbouring cells.
+ */
+#define STREAM_MAX_CELL (4611686018427387904.0)
+
+typedef struct {
+    int64_t cx;
+    int64_t cy;
+    size_t head;
+    int used;
+} streamslot;
+
+typedef struct {
+    point *points;
+    size_t *next;
+    size_t stored;
+    size_t capacity;
+
+    streamslot *slots;
+    size_t mask;
+    size_t cells;
+
+    float delta;
+    float bestSq;
+    point pair[2];
+    size_t found;
+} streamstate;
+
+/**
+ * @brief Returns the cell coordinate of a value for the current delta.
+ */
+static int64_t streamcell(double value, float delta) {
+    double cell = floor(value / delta);
+    cell = (cell > STREAM_MAX_CELL) ? STREAM_MAX_CELL : cell;
+    cell = (cell < -STREAM_MAX_CELL) ? -STREAM_MAX_CELL : cell;
+    return (int64_t)cell;
+}
+
+/**
+ * @brief Finds the slot of a cell, which is either the used slot of that cell or the free slot it would go into.
+ */
+static streamslot *streamfind(streamstate *state, int64_t cx, int64_t cy) {
+    uint64_t h = (uint64_t)cx * 0x9E3779B97F4A7C15ULL ^ (uint64_t)cy * 0xC2B2AE3D27D4EB4FULL;
+    size_t i = (size_t)(h ^ (h >> 29)) & state->mask;
+    while (state->slots[i].used && (state->slots[i].cx != cx || state->slots[i].cy != cy)) {
+        i = (i + 1) & state->mask;
+    }
+    return &state->slots[i];
+}
+
+/**
+ * @brief Adds the point with the given index to the chain of its cell.
+ */
+static void streamlink(streamstate *state, size_t i) {
+    int64_t cx = streamcell(state->points[i].x, state->delta);
+    int64_t cy = streamcell(state->points[i].y, state->delta);
+    streamslot *slot = streamfind(state, cx, cy);
+
+    if (!slot->used) {
+        slot->used = 1;
+        slot->cx = cx;
+        slot->cy = cy;
+        slot->head = STREAM_NONE;
+        state->cells++;
+    }
+
+    state->next[i] = slot->head;
+    slot->head = i;
+}
+
+/**
+ * @brief Rebuilds the grid for the current delta, with a table that fits the amount of points.
+ */
+static void streamrebuild(streamstate *state, const char *process) {
+    size_t size = 16;
+    while (size < 2 * state->capacity) {
+        size *= 2;
+    }
+
+    free(state->slots);
+    state->slots = calloc(size, sizeof(streamslot));
+    if (state->slots == NULL) {
+        error("Failed to allocate memory", process);
+    }
+    state->mask = size - 1;
+    state->cells = 0;
+
+    for (size_t i = 0; i < state->stored; i++) {
+        streamlink(state, i);
+    }
+}
+
+/**
+ * @brief Looks for points closer than delta around a new point, updating the best pair.
+ * @return 1 if the best pair changed, 0 otherwise.
+ */
+static int streamsearch(streamstate *state, point p) {
+    int64_t cx = streamcell(p.x, state->delta);
+    int64_t cy = streamcell(p.y, state->delta);
+    int changed = 0;
+
+    for (int64_t dx = -1; dx <= 1; dx++) {
+        for (int64_t dy = -1; dy <= 1; dy++) {
+            streamslot *slot = streamfind(state, cx + dx, cy + dy);
+            if (!slot->used) {
+                continue;
+            }
+
+            for (size_t j = slot->head; j != STREAM_NONE; j = state->next[j]) {
+                float distance = sqdistance(p, state->points[j]);
+                if (distance < state->bestSq) {
+                    state->bestSq = distance;
+                    state->pair[0] = p;
+                    state->pair[1] = state->points[j];
+                    changed = 1;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief Stores a new point, growing the arrays if needed.
+ * @return 1 if the table has to be rebuilt because it got too full, 0 otherwise.
+ */
+static int streamstore(streamstate *state, point p, const char *process) {
+    if (state->stored == state->capacity) {
+        size_t capacity = (state->capacity == 0) ? 1024 : state->capacity * 2;
+        point *points = realloc(state->points, sizeof(point) * capacity);
+        if (points == NULL) {
+            error("Failed to allocate memory", process);
+        }
+        state->points = points;
+
+        size_t *next = realloc(state->next, sizeof(size_t) * capacity);
+        if (next == NULL) {
+            error("Failed to allocate memory", process);
+        }
+        state->next = next;
+        state->capacity = capacity;
+    }
+
+    state->points[state->stored] = p;
+    state->stored++;
+    return state->slots == NULL || 2 * (state->cells + 1) > state->mask;
+}
+
+int streamcpair(FILE *input, FILE *output, const char *process) {
+    streamstate state;
+    memset(&state, 0, sizeof(state));
+    state.bestSq = INFINITY;
+
+    char *line = NULL;
+    size_t linelen = 0;
+    while (getline(&line, &linelen, input) != -1) {
+        // Nothing can beat two identical points, the rest of the stream only gets drained
+        if (state.found == 2 && state.bestSq == 0.0f) {
+            continue;
+        }
+
+        point p = strtop(line, process);
+        int changed = 0;
+
+        if (state.stored == 1) {
+            state.pair[0] = p;
+            state.pair[1] = state.points[0];
+            state.bestSq = sqdistance(p, state.points[0]);
+            state.found = 2;
+            changed = 1;
+        } else if (state.stored > 1 && state.bestSq > 0.0f) {
+            changed = streamsearch(&state, p);
+        }
+
+        int full = streamstore(&state, p, process);
+
+        if (changed && state.bestSq > 0.0f) {
+            state.delta = sqrtf(state.bestSq);
+            streamrebuild(&state, process);
+        } else if (state.found == 2 && state.bestSq > 0.0f) {
+            if (full) {
+                streamrebuild(&state, process);
+            } else {
+                streamlink(&state, state.stored - 1);
+            }
+        }
+
+        if (changed) {
+            printpairsorted(output, state.pair, process);
+            fflush(output);
+        }
+    }
+
+    free(line);
+    free(state.slots);
+    free(state.next);
+    free(state.points);
+
+    if (state.stored == 0) {
+        fprintf(stderr, "[%s] ERROR: No points provided via stdin!\n", process);
+        return -1;
+    }
+    return 0;
+}
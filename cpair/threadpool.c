@@ -0,0 +1,239 @@
+/**
+ * @file threadpool.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief A small fork-join thread pool with per-worker deques and work stealing.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "sched.h"
+#include "threadpool.h"
+
+/**
+ * @brief Runs a task and marks it as done.
+ * @param self The worker running the task.
+ * @param task &mut The task you intend to run.
+ */
+static void runtask(poolworker *self, pooltask *task) {
+    task->run(self, task->arg);
+    __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Pushes a task to the bottom (owner end) of a deque.
+ * @param pending &mut The amount of queued tasks of the pool.
+ * @return 0 if successful -1 if the deque could not grow.
+ */
+static int dequepush(pooldeque *deque, pooltask *task, size_t *pending) {
+    pthread_mutex_lock(&deque->mutex);
+
+    if (deque->bottom == deque->capacity) {
+        if (deque->top > 0) {
+            // Reuse the slots that were freed by thieves
+            memmove(deque->tasks, deque->tasks + deque->top, sizeof(pooltask *) * (deque->bottom - deque->top));
+            deque->bottom -= deque->top;
+            deque->top = 0;
+        } else {
+            size_t capacity = (deque->capacity == 0) ? 16 : deque->capacity * 2;
+            pooltask **tmp = realloc(deque->tasks, sizeof(pooltask *) * capacity);
+            if (tmp == NULL) {
+                pthread_mutex_unlock(&deque->mutex);
+                return -1;
+            }
+            deque->tasks = tmp;
+            deque->capacity = capacity;
+        }
+    }
+
+    deque->tasks[deque->bottom] = task;
+    deque->bottom++;
+    __atomic_fetch_add(pending, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&deque->mutex);
+    return 0;
+}
+
+/**
+ * @brief Pops the given task from the bottom of a deque if it has not been stolen yet.
+ * @return 1 if the task was popped, 0 otherwise.
+ */
+static int dequepop(pooldeque *deque, pooltask *task, size_t *pending) {
+    int popped = 0;
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->bottom > deque->top && deque->tasks[deque->bottom - 1] == task) {
+        deque->bottom--;
+        __atomic_fetch_sub(pending, 1, __ATOMIC_SEQ_CST);
+        popped = 1;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return popped;
+}
+
+/**
+ * @brief Takes the oldest task from the top of a deque.
+ * @return The task or NULL if the deque is empty.
+ */
+static pooltask *dequesteal(pooldeque *deque, size_t *pending) {
+    pooltask *task = NULL;
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->bottom > deque->top) {
+        task = deque->tasks[deque->top];
+        deque->top++;
+        __atomic_fetch_sub(pending, 1, __ATOMIC_SEQ_CST);
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return task;
+}
+
+/**
+ * @brief Tries to steal and run one task of another worker, starting at a random victim.
+ * @return 1 if a task was run, 0 otherwise.
+ */
+static int stealandrun(poolworker *self) {
+    pool *p = self->pool;
+    if (p->size < 2) {
+        return 0;
+    }
+
+    size_t start = (size_t)rand_r(&self->seed) % p->size;
+    for (size_t i = 0; i < p->size; i++) {
+        size_t victim = (start + i) % p->size;
+        if (victim == self->index) {
+            continue;
+        }
+
+        pooltask *task = dequesteal(&p->workers[victim].deque, &p->pending);
+        if (task != NULL) {
+            runtask(self, task);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Sleeps until a task is queued somewhere or the pool is stopped.
+ * @details sleepers and pending are both sequentially consistent, so either the sleeper sees the new task
+ * or the spawner sees the sleeper and signals it under the mutex.
+ */
+static void park(pool *p) {
+    pthread_mutex_lock(&p->mutex);
+    __atomic_fetch_add(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&p->pending, __ATOMIC_SEQ_CST) == 0 && __atomic_load_n(&p->stop, __ATOMIC_ACQUIRE) == 0) {
+        pthread_cond_wait(&p->wakeup, &p->mutex);
+    }
+    __atomic_fetch_sub(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+/**
+ * @brief The loop every worker thread (except worker 0) runs until the pool is stopped.
+ * @details A worker that finds nothing to steal parks instead of spinning.
+ * @param arg The worker.
+ */
+static void *workerloop(void *arg) {
+    poolworker *self = arg;
+
+    while (__atomic_load_n(&self->pool->stop, __ATOMIC_ACQUIRE) == 0) {
+        if (stealandrun(self) == 0) {
+            park(self->pool);
+        }
+    }
+    return NULL;
+}
+
+pool *poolcreate(size_t size) {
+    if (size == 0) {
+        size = 1;
+    }
+
+    pool *p = malloc(sizeof(pool));
+    if (p == NULL) {
+        return NULL;
+    }
+
+    p->workers = calloc(size, sizeof(poolworker));
+    if (p->workers == NULL) {
+        free(p);
+        return NULL;
+    }
+    p->size = size;
+    p->stop = 0;
+    p->pending = 0;
+    p->sleepers = 0;
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->wakeup, NULL);
+
+    for (size_t i = 0; i < size; i++) {
+        p->workers[i].pool = p;
+        p->workers[i].index = i;
+        p->workers[i].seed = (unsigned int)i + 1;
+        pthread_mutex_init(&p->workers[i].deque.mutex, NULL);
+    }
+
+    // Worker 0 is the calling thread
+    for (size_t i = 1; i < size; i++) {
+        if (pthread_create(&p->workers[i].thread, NULL, workerloop, &p->workers[i]) != 0) {
+            p->size = i;
+            pooldestroy(p);
+            return NULL;
+        }
+    }
+
+    return p;
+}
+
+poolworker *poolmain(pool *p) {
+    return &p->workers[0];
+}
+
+void poolspawn(poolworker *self, pooltask *task) {
+    task->done = 0;
+    pool *p = self->pool;
+    if (dequepush(&self->deque, task, &p->pending) == -1) {
+        runtask(self, task);
+        return;
+    }
+
+    if (__atomic_load_n(&p->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&p->mutex);
+        pthread_cond_signal(&p->wakeup);
+        pthread_mutex_unlock(&p->mutex);
+    }
+}
+
+void pooljoin(poolworker *self, pooltask *task) {
+    if (dequepop(&self->deque, task, &self->pool->pending)) {
+        runtask(self, task);
+        return;
+    }
+
+    // The task was stolen, help out elsewhere until the thief is done with it, which is usually soon enough
+    // that yielding beats parking
+    while (__atomic_load_n(&task->done, __ATOMIC_ACQUIRE) == 0) {
+        if (stealandrun(self) == 0) {
+            sched_yield();
+        }
+    }
+}
+
+void pooldestroy(pool *p) {
+    __atomic_store_n(&p->stop, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&p->mutex);
+    pthread_cond_broadcast(&p->wakeup);
+    pthread_mutex_unlock(&p->mutex);
+
+    for (size_t i = 1; i < p->size; i++) {
+        pthread_join(p->workers[i].thread, NULL);
+    }
+
+    for (size_t i = 0; i < p->size; i++) {
+        pthread_mutex_destroy(&p->workers[i].deque.mutex);
+        free(p->workers[i].deque.tasks);
+    }
+
+    pthread_mutex_destroy(&p->mutex);
+    pthread_cond_destroy(&p->wakeup);
+    free(p->workers);
+    free(p);
+}
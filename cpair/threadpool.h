@@ -0,0 +1,89 @@
+/**
+ * @file threadpool.h
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief A small fork-join thread pool with per-worker deques and work stealing.
+ * @details The thread creating the pool acts as worker 0, so a pool of n workers only starts n - 1 threads.
+ * A task is spawned onto the deque of the spawning worker and must be joined by that same worker.
+ * While waiting on a join, a worker keeps executing tasks from its own deque or steals from others.
+ * Workers without anything to join sleep on a condition variable until a task is spawned.
+ **/
+
+#ifndef OSVU_THREADPOOL_H
+#define OSVU_THREADPOOL_H
+
+#include "pthread.h"
+#include "stddef.h"
+
+typedef struct pool pool;
+typedef struct poolworker poolworker;
+
+typedef struct {
+    void (*run)(poolworker *self, void *arg);
+    void *arg;
+    int done;
+} pooltask;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pooltask **tasks;
+    size_t top;
+    size_t bottom;
+    size_t capacity;
+} pooldeque;
+
+struct poolworker {
+    pool *pool;
+    size_t index;
+    pthread_t thread;
+    pooldeque deque;
+    unsigned int seed;
+};
+
+struct pool {
+    poolworker *workers;
+    size_t size;
+    int stop;
+    // Idle workers sleep on wakeup while no deque holds a task
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    size_t pending;
+    size_t sleepers;
+};
+
+/**
+ * @brief Creates a pool of the given size and starts its threads.
+ * @param size The amount of workers including the calling thread, at least 1.
+ * @return The pool or NULL if memory or threads could not be acquired.
+ */
+pool *poolcreate(size_t size);
+
+/**
+ * @brief Returns the worker that represents the thread which created the pool.
+ * @param p The pool.
+ */
+poolworker *poolmain(pool *p);
+
+/**
+ * @brief Makes a task available to be run by any worker.
+ * @param self The worker calling this function.
+ * @details If the task cannot be queued it is run right away by the calling worker.
+ * @param task &mut An initialised task that has to stay alive until it is joined.
+ */
+void poolspawn(poolworker *self, pooltask *task);
+
+/**
+ * @brief Waits for a previously spawned task, running other tasks in the meantime.
+ * @param self The worker that spawned the task.
+ * @param task &mut The task you intend to wait for.
+ */
+void pooljoin(poolworker *self, pooltask *task);
+
+/**
+ * @brief Stops all threads of the pool and frees it.
+ * @details There must not be any outstanding tasks.
+ * @param p The pool you intend to destroy.
+ */
+void pooldestroy(pool *p);
+
+#endif //OSVU_THREADPOOL_H
@@ -0,0 +1,134 @@
+/**
+ * @file trace.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief Per process timings of the process tree as Chrome trace events.
+ * @details Every process of the tree collects its events in memory and appends them to the trace file
+ * with a single write when it exits, so the events of different processes never interleave.
+ * The root truncates the file and opens the JSON array when it starts and closes the array
+ * when it exits, which is after every other process of the tree is gone.
+ * Timestamps come from CLOCK_MONOTONIC, which all processes share.
+ * The file can be opened with chrome://tracing or https://ui.perfetto.dev.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "stdarg.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "errno.h"
+#include "time.h"
+#include "cpair.h"
+
+typedef struct {
+    int fd;
+    long depth;
+    size_t points;
+    double start;
+    pid_t pid;
+    char *buffer;
+    size_t stored;
+    size_t capacity;
+} tracestate;
+
+static tracestate state = {.fd = -1};
+
+/**
+ * @brief Appends formatted text to the event buffer, dropping it if memory runs out.
+ */
+static void traceprintf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+
+    if (state.stored + (size_t)length + 1 > state.capacity) {
+        size_t capacity = (state.capacity == 0) ? 4096 : state.capacity;
+        while (state.stored + (size_t)length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char *tmp = realloc(state.buffer, capacity);
+        if (tmp == NULL) {
+            return;
+        }
+        state.buffer = tmp;
+        state.capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(state.buffer + state.stored, state.capacity - state.stored, format, args);
+    va_end(args);
+    state.stored += (size_t)length;
+}
+
+/**
+ * @brief Writes the events of this process to the trace file, registered with atexit.
+ */
+static void traceclose(void) {
+    // A forked child that failed to exec must not write the events of its parent
+    if (state.fd == -1 || getpid() != state.pid) {
+        return;
+    }
+
+    traceevent("node", state.start);
+    // The name of the process is the last event, without a trailing comma if this is the root
+    traceprintf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,\"args\":{\"name\":\"depth %ld (%zu points)\"}}%s\n",
+                (long)state.pid, state.depth, state.points, (state.depth == 0) ? "\n]" : ",");
+
+    size_t written = 0;
+    while (written < state.stored) {
+        ssize_t result = write(state.fd, state.buffer + written, state.stored - written);
+        if (result == -1 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        written += (size_t)result;
+    }
+
+    close(state.fd);
+    free(state.buffer);
+    state.fd = -1;
+}
+
+double tracetime(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e6 + (double)now.tv_nsec / 1e3;
+}
+
+void traceopen(const char *path, long depth, const char *process) {
+    int flags = (depth == 0) ? O_WRONLY | O_CREAT | O_TRUNC | O_APPEND : O_WRONLY | O_APPEND;
+    state.fd = open(path, flags, 0644);
+    if (state.fd == -1) {
+        fprintf(stderr, "[%s] ERROR: Cannot open %s: %s\n", process, path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    state.depth = depth;
+    state.start = tracetime();
+    state.pid = getpid();
+    if (depth == 0 && write(state.fd, "[\n", 2) != 2) {
+        error("Error writing to file", process);
+    }
+    atexit(traceclose);
+}
+
+void tracepoints(size_t stored) {
+    state.points = stored;
+}
+
+void traceevent(const char *name, double start) {
+    if (state.fd == -1) {
+        return;
+    }
+
+    double end = tracetime();
+    traceprintf("{\"name\":\"%s\",\"cat\":\"cpair\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld,"
+                "\"args\":{\"depth\":%ld,\"points\":%zu}},\n",
+                name, start, end - start, (long)state.pid, (long)state.pid, state.depth, state.points);
+}
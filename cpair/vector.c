@@ -0,0 +1,325 @@
+/**
+ * @file vector.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The closest pair of points with any number of dimensions.
+ * @details Every line holds one point, the dimension is the amount of coordinates on the first line
+ * (or CPAIR_DIMENSION if the program was compiled with it, which lets the compiler unroll the distance loop).
+ * The recursion splits at the median of the coordinate depth % dimension, so the split axes cycle
+ * like in a k-d tree. Only points whose split coordinate is closer than delta to the split can form
+ * a closer pair across it. That slab is swept along the next axis, where again only points closer than
+ * delta on that axis have to be compared.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+#include "cpair.h"
+
+/**
+ * Subproblems of at most this many points are solved by comparing every pair.
+ */
+#define VECTOR_BRUTE_FORCE_LIMIT (8)
+
+#ifdef CPAIR_DIMENSION
+#define VECTOR_DIMENSION(state) ((size_t)(CPAIR_DIMENSION))
+#else
+#define VECTOR_DIMENSION(state) ((state)->dimension)
+#endif
+
+typedef struct {
+    float key;
+    size_t point;
+    int side;
+} vectorslab;
+
+typedef struct {
+    // Row major, dimension coordinates per point
+    float *coordinates;
+    size_t dimension;
+    size_t stored;
+    // Indices of the points, reordered by the recursion instead of the rows themselves
+    size_t *order;
+    // Points near the split line of the current level, with their coordinate on the sweep axis
+    vectorslab *slab;
+
+    float bestSq;
+    size_t pair[2];
+} vectorstate;
+
+/**
+ * @brief Returns the coordinates of a point.
+ */
+static const float *vectorrow(const vectorstate *state, size_t point) {
+    return state->coordinates + point * VECTOR_DIMENSION(state);
+}
+
+/**
+ * @brief Returns the squared distance of two points.
+ */
+static float vectorsqdistance(const vectorstate *state, size_t a, size_t b) {
+#ifdef CPAIR_DIMENSION
+    const float *p = vectorrow(state, a);
+    const float *q = vectorrow(state, b);
+    float distance = 0.0f;
+    for (size_t i = 0; i < (size_t)(CPAIR_DIMENSION); i++) {
+        float diff = p[i] - q[i];
+        distance += diff * diff;
+    }
+    return distance;
+#else
+    return sqdistancen(vectorrow(state, a), vectorrow(state, b), state->dimension);
+#endif
+}
+
+/**
+ * @brief Updates the best pair if the two points are closer.
+ */
+static void vectoroffer(vectorstate *state, size_t a, size_t b) {
+    float distance = vectorsqdistance(state, a, b);
+    if (distance < state->bestSq) {
+        state->bestSq = distance;
+        state->pair[0] = a;
+        state->pair[1] = b;
+    }
+}
+
+/**
+ * @brief Moves the median of order[0..stored) on the given axis to position middle,
+ * smaller coordinates before it and larger ones after it.
+ */
+static void vectorselect(const vectorstate *state, size_t *order, size_t stored, size_t middle, size_t axis) {
+    size_t from = 0;
+    size_t to = stored;
+    while (to - from > 1) {
+        float pivot = vectorrow(state, order[from + (to - from) / 2])[axis];
+        size_t i = from;
+        size_t lt = from;
+        size_t gt = to;
+
+        // Three way partition into < pivot, == pivot and > pivot
+        while (i < gt) {
+            float c = vectorrow(state, order[i])[axis];
+            if (c < pivot) {
+                size_t tmp = order[lt];
+                order[lt++] = order[i];
+                order[i++] = tmp;
+            } else if (c > pivot) {
+                size_t tmp = order[--gt];
+                order[gt] = order[i];
+                order[i] = tmp;
+            } else {
+                i++;
+            }
+        }
+
+        if (middle < lt) {
+            to = lt;
+        } else if (middle >= gt) {
+            from = gt;
+        } else {
+            return;
+        }
+    }
+}
+
+static int compareslab(const void *a, const void *b) {
+    const vectorslab *s1 = a;
+    const vectorslab *s2 = b;
+    return (s1->key < s2->key) ? -1 : (s1->key > s2->key);
+}
+
+/**
+ * @brief Finds the closest pair of order[0..stored), the split axis is depth % dimension.
+ */
+static void vectorsolve(vectorstate *state, size_t *order, size_t stored, size_t depth) {
+    if (stored <= VECTOR_BRUTE_FORCE_LIMIT) {
+        for (size_t i = 0; i < stored; i++) {
+            for (size_t j = i + 1; j < stored; j++) {
+                vectoroffer(state, order[i], order[j]);
+            }
+        }
+        return;
+    }
+
+    size_t dimension = VECTOR_DIMENSION(state);
+    size_t axis = depth % dimension;
+    size_t middle = stored / 2;
+    vectorselect(state, order, stored, middle, axis);
+    float split = vectorrow(state, order[middle])[axis];
+
+    vectorsolve(state, order, middle, depth + 1);
+    vectorsolve(state, order + middle, stored - middle, depth + 1);
+    if (state->bestSq == 0.0f) {
+        return;
+    }
+
+    // Both halves are done, so the slab space can be reused at every level
+    size_t sweep = (axis + 1) % dimension;
+    size_t count = 0;
+    for (size_t i = 0; i < stored; i++) {
+        const float *row = vectorrow(state, order[i]);
+        float diff = row[axis] - split;
+        if (diff * diff < state->bestSq) {
+            state->slab[count].key = row[sweep];
+            state->slab[count].point = order[i];
+            state->slab[count].side = (i >= middle);
+            count++;
+        }
+    }
+    qsort(state->slab, count, sizeof(vectorslab), compareslab);
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = i + 1; j < count; j++) {
+            float diff = state->slab[j].key - state->slab[i].key;
+            if (diff * diff >= state->bestSq) {
+                break;
+            }
+            if (state->slab[i].side != state->slab[j].side) {
+                vectoroffer(state, state->slab[i].point, state->slab[j].point);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Counts the coordinates on a line, exits if there are none or the line is malformed.
+ */
+static size_t vectorcount(const char *line, const char *process) {
+    size_t count = 0;
+    const char *c = line;
+    for (;;) {
+        while (*c == ' ' || *c == '\t') {
+            c++;
+        }
+        if (*c == '\n' || *c == '\0') {
+            break;
+        }
+
+        char *endptr;
+        strtof(c, &endptr);
+        if (endptr == c) {
+            error("Malformed input line", process);
+        }
+        count++;
+        c = endptr;
+    }
+
+    if (count == 0) {
+        error("Malformed input line", process);
+    }
+    return count;
+}
+
+/**
+ * @brief Parses a line of coordinates into a row, exits if it is malformed.
+ * @return The amount of coordinates on the line.
+ */
+static size_t vectorparse(char *line, vectorstate *state, const char *process) {
+    size_t count = 0;
+    char *c = line;
+    for (;;) {
+        while (*c == ' ' || *c == '\t') {
+            c++;
+        }
+        if (*c == '\n' || *c == '\0') {
+            break;
+        }
+
+        if (count == state->dimension) {
+            error("Every point must have as many coordinates as the first one", process);
+        }
+
+        char *endptr;
+        float value = strtof(c, &endptr);
+        if (endptr == c || (*endptr != ' ' && *endptr != '\t' && *endptr != '\n' && *endptr != '\0')) {
+            error("Malformed input line", process);
+        }
+        state->coordinates[state->stored * state->dimension + count] = value;
+        count++;
+        c = endptr;
+    }
+    return count;
+}
+
+int vectorcpair(FILE *input, FILE *output, const char *process) {
+    vectorstate state;
+    memset(&state, 0, sizeof(state));
+    state.bestSq = INFINITY;
+
+    char *line = NULL;
+    size_t linelen = 0;
+    size_t capacity = 0;
+    while (getline(&line, &linelen, input) != -1) {
+        if (state.dimension == 0) {
+            size_t count = vectorcount(line, process);
+#ifdef CPAIR_DIMENSION
+            if (count != (size_t)(CPAIR_DIMENSION)) {
+                error("The points do not have CPAIR_DIMENSION coordinates", process);
+            }
+#endif
+            state.dimension = count;
+        }
+
+        if (state.stored == capacity) {
+            capacity = (capacity == 0) ? 1024 : capacity * 2;
+            float *coordinates = realloc(state.coordinates, sizeof(float) * capacity * state.dimension);
+            if (coordinates == NULL) {
+                error("Failed to allocate memory", process);
+            }
+            state.coordinates = coordinates;
+        }
+
+        if (vectorparse(line, &state, process) != state.dimension) {
+            error("Every point must have as many coordinates as the first one", process);
+        }
+        state.stored++;
+    }
+    free(line);
+
+    if (state.stored == 0) {
+        fprintf(stderr, "[%s] ERROR: No points provided via stdin!\n", process);
+        return -1;
+    }
+
+    if (state.stored >= 2) {
+        state.order = malloc(sizeof(size_t) * state.stored);
+        state.slab = malloc(sizeof(vectorslab) * state.stored);
+        if (state.order == NULL || state.slab == NULL) {
+            error("Failed to allocate memory", process);
+        }
+        for (size_t i = 0; i < state.stored; i++) {
+            state.order[i] = i;
+        }
+
+        vectorsolve(&state, state.order, state.stored, 0);
+
+        // Same order as printpairsorted, lexicographic on the coordinates
+        const float *a = vectorrow(&state, state.pair[0]);
+        const float *b = vectorrow(&state, state.pair[1]);
+        size_t first = 0;
+        for (size_t i = 0; i < state.dimension; i++) {
+            if (a[i] != b[i]) {
+                first = (a[i] < b[i]) ? 0 : 1;
+                break;
+            }
+        }
+
+        for (size_t p = 0; p < 2; p++) {
+            const float *row = vectorrow(&state, state.pair[(p == 0) ? first : 1 - first]);
+            for (size_t i = 0; i < state.dimension; i++) {
+                fprintf(output, (i == 0) ? "%.3f" : " %.3f", row[i]);
+            }
+            fputc('\n', output);
+        }
+        if (fflush(output) == EOF) {
+            error("Error writing to file", process);
+        }
+
+        free(state.order);
+        free(state.slab);
+    }
+
+    free(state.coordinates);
+    return 0;
+}
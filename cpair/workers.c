@@ -0,0 +1,272 @@
+/**
+ * @file workers.c
+ * @author Ivan Cankov 12219400 <e12219400@student.tuwien.ac.at>
+ * @date 17.10.2026
+ * @brief The worker pool mode of the process tree.
+ * @details The root spawns a fixed amount of long lived worker processes up front, instead of
+ * a fresh process for every subproblem. It splits the points at the median like the process tree
+ * until the subproblems are small enough, hands them to idle workers as jobs (binary wire format
+ * over a pipe per worker) and merges their results bottom up along the same splits.
+ * Every job gets answered with the closest pair of its points, a worker exits once its job pipe is closed.
+ **/
+
+#include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "errno.h"
+#include "poll.h"
+#include "sys/wait.h"
+#include "cpair.h"
+
+/**
+ * Every worker gets about this many jobs, so that workers finishing early can take over more of them.
+ */
+#define WORKER_JOBS_PER_WORKER (4)
+#define WORKER_IDLE (SIZE_MAX)
+
+typedef struct {
+    pid_t pid;
+    // The root writes jobs to this
+    int jobFd;
+    // The root reads results from this
+    int resultFd;
+    size_t job;
+} worker;
+
+typedef struct {
+    size_t offset;
+    size_t stored;
+    point pair[2];
+    size_t found;
+} workerjob;
+
+/**
+ * A split of the recursion, stored in pre-order.
+ */
+typedef struct {
+    float split;
+    char axis;
+} workersplit;
+
+typedef struct {
+    point *points;
+    size_t jobSize;
+
+    workerjob *jobs;
+    size_t storedJobs;
+    workersplit *splits;
+    size_t storedSplits;
+    // Read positions while merging, in the same order the splits and jobs were created
+    size_t nextJob;
+    size_t nextSplit;
+} workertree;
+
+/**
+ * @brief Splits points[offset..offset + stored) at the median until the parts are small enough to be jobs.
+ */
+static void workerdivide(workertree *tree, size_t offset, size_t stored) {
+    if (stored <= tree->jobSize) {
+        workerjob *job = &tree->jobs[tree->storedJobs++];
+        job->offset = offset;
+        job->stored = stored;
+        job->found = 0;
+        return;
+    }
+
+    point *points = tree->points + offset;
+    char axis = (countcoordinates(points, stored, 'x') == (int)stored) ? 'y' : 'x';
+    workersplit *split = &tree->splits[tree->storedSplits++];
+    split->axis = axis;
+    split->split = medianpx(points, stored, axis);
+
+    workerdivide(tree, offset, stored / 2);
+    workerdivide(tree, offset + stored / 2, stored - stored / 2);
+}
+
+/**
+ * @brief Merges the results of the jobs bottom up, visiting the parts in the order workerdivide created them.
+ * @return The amount of points written to pair (0 or 2).
+ */
+static size_t workermerge(workertree *tree, size_t offset, size_t stored, point pair[2], const char *process) {
+    if (stored <= tree->jobSize) {
+        workerjob *job = &tree->jobs[tree->nextJob++];
+        pair[0] = job->pair[0];
+        pair[1] = job->pair[1];
+        return job->found;
+    }
+
+    workersplit split = tree->splits[tree->nextSplit++];
+    point left[2];
+    point right[2];
+    size_t a = workermerge(tree, offset, stored / 2, left, process);
+    size_t b = workermerge(tree, offset + stored / 2, stored - stored / 2, right, process);
+
+    if (mergechildren(left, a, right, b, pair) != 0) {
+        return 0;
+    }
+    mergefinal(tree->points + offset, stored, pair, split.split, split.axis, process);
+    return 2;
+}
+
+/**
+ * @brief Hands the next job to a worker.
+ * @return 0 if successful -1 otherwise
+ */
+static int workersend(worker *w, workertree *tree, size_t job) {
+    w->job = job;
+    return patofd(w->jobFd, tree->points + tree->jobs[job].offset, tree->jobs[job].stored);
+}
+
+/**
+ * @brief Starts the worker processes.
+ * @return The amount of workers that could be started.
+ */
+static size_t workerspawn(worker *workers, size_t count, const char *process) {
+    char *args[] = {(char *)process, "-W", NULL};
+
+    for (size_t i = 0; i < count; i++) {
+        int jobPipe[2];
+        int resultPipe[2];
+        if (pipecloexec(jobPipe) == -1) {
+            return i;
+        }
+        if (pipecloexec(resultPipe) == -1) {
+            close(jobPipe[0]);
+            close(jobPipe[1]);
+            return i;
+        }
+
+        workers[i].pid = spawnpiped(args, jobPipe[0], resultPipe[1]);
+        close(jobPipe[0]);
+        close(resultPipe[1]);
+        if (workers[i].pid == -1) {
+            fprintf(stderr, "[%s] ERROR: Cannot spawn: %s\n", process, strerror(errno));
+            close(jobPipe[1]);
+            close(resultPipe[0]);
+            return i;
+        }
+
+        workers[i].jobFd = jobPipe[1];
+        workers[i].resultFd = resultPipe[0];
+        workers[i].job = WORKER_IDLE;
+    }
+    return count;
+}
+
+size_t workercpair(point *points, size_t stored, size_t count, point pair[2], const char *process) {
+    worker *workers = malloc(sizeof(worker) * count);
+    struct pollfd *fds = malloc(sizeof(struct pollfd) * count);
+    workertree tree = {.points = points};
+
+    // Parts of at least 2 points, so that every split leaves a pair on one of its sides
+    size_t jobs = count * WORKER_JOBS_PER_WORKER;
+    tree.jobSize = (stored + jobs - 1) / jobs;
+    tree.jobSize = (tree.jobSize < 2) ? 2 : tree.jobSize;
+    tree.jobs = malloc(sizeof(workerjob) * stored);
+    tree.splits = malloc(sizeof(workersplit) * stored);
+
+    if (workers == NULL || fds == NULL || tree.jobs == NULL || tree.splits == NULL) {
+        error("Failed to allocate memory", process);
+    }
+
+    workerdivide(&tree, 0, stored);
+
+    size_t spawned = workerspawn(workers, count, process);
+    if (spawned == 0) {
+        free(workers);
+        free(fds);
+        free(tree.jobs);
+        free(tree.splits);
+        return 0;
+    }
+
+    int failed = 0;
+    size_t sent = 0;
+    size_t done = 0;
+    for (size_t i = 0; i < spawned && sent < tree.storedJobs; i++) {
+        failed |= workersend(&workers[i], &tree, sent++) == -1;
+    }
+
+    while (done < tree.storedJobs && !failed) {
+        size_t busy = 0;
+        for (size_t i = 0; i < spawned; i++) {
+            if (workers[i].job != WORKER_IDLE) {
+                fds[busy].fd = workers[i].resultFd;
+                fds[busy].events = POLLIN;
+                fds[busy].revents = 0;
+                busy++;
+            }
+        }
+
+        if (poll(fds, busy, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = 1;
+            break;
+        }
+
+        for (size_t i = 0, f = 0; i < spawned; i++) {
+            if (workers[i].job == WORKER_IDLE) {
+                continue;
+            }
+            if (fds[f++].revents == 0) {
+                continue;
+            }
+
+            // A worker that died closes its pipe, which shows up as a result without a header
+            workerjob *job = &tree.jobs[workers[i].job];
+            job->found = ctopbinary(workers[i].resultFd, job->pair, process);
+            if (job->found == 0 && job->stored >= 2) {
+                fprintf(stderr, "[%s] ERROR: A worker failed\n", process);
+                failed = 1;
+                break;
+            }
+            workers[i].job = WORKER_IDLE;
+            done++;
+
+            if (sent < tree.storedJobs) {
+                failed |= workersend(&workers[i], &tree, sent++) == -1;
+            }
+        }
+    }
+
+    // Closing the job pipes makes the workers exit
+    for (size_t i = 0; i < spawned; i++) {
+        close(workers[i].jobFd);
+        close(workers[i].resultFd);
+    }
+    for (size_t i = 0; i < spawned; i++) {
+        int status;
+        waitpid(workers[i].pid, &status, 0);
+    }
+
+    size_t found = 0;
+    if (!failed) {
+        found = workermerge(&tree, 0, stored, pair, process);
+    }
+
+    free(workers);
+    free(fds);
+    free(tree.jobs);
+    free(tree.splits);
+    return found;
+}
+
+int workerloop(const char *process) {
+    for (;;) {
+        point *points;
+        ssize_t stored = fdtopa(STDIN_FILENO, &points, process);
+        if (stored == 0) {
+            free(points);
+            return 0;
+        }
+
+        point pair[2];
+        size_t found = threadedcpair(points, (size_t)stored, 1, (size_t)stored + 1, pair, process);
+        free(points);
+        if (patofd(STDOUT_FILENO, pair, found) == -1) {
+            error("Error writing to file", process);
+        }
+    }
+}
@@ -4,17 +4,69 @@
  * @date 12.09.2023
  * @brief OSUE Exercise 2 fb_arc_set
  * @details Generates possible solutions that get written
- * to the shared memory created by the supervisor.
+ * to the shared memory created by the supervisor. With -t several
+ * generator threads share one process, each with its own random
+ * number generator and permutation. The graph is kept in compressed
+ * sparse row form with 32 bit vertex indices, with -f its edges can be
+ * read from a file instead of the arguments. With -l every random
+ * permutation is improved by local search before it is evaluated.
+ * Before generating, the graph is split into its strongly connected
+ * components. Only edges inside a component can lie on a cycle, small
+ * components are solved exactly and only the large ones are permuted.
  */
 
 #include "utils.h"
+
+/**
+ * @brief State of a xoshiro256** random number generator.
+ */
+typedef struct {
+    uint64_t s[4];
+} rng_state;
+
+/**
+ * @brief A directed graph in compressed sparse row form.
+ *
+ * The edges leaving vertex u end in targets[offsets[u]] to targets[offsets[u + 1] - 1],
+ * in ascending order, so the positions of the targets are looked up front to back.
+ * The edges entering a vertex are only built for local search, the same way.
+ */
+typedef struct {
+    uint32_t *offsets;
+    uint32_t *targets;
+    uint32_t *in_offsets;
+    uint32_t *sources;
+    // the largest number of edges entering and leaving a single vertex
+    size_t max_degree;
+    // the index every vertex had in the input
+    uint32_t *ids;
+} csr_graph;
+
+/**
+ * @brief A neighbour of the vertex local search tries to move.
+ */
+typedef struct {
+    uint32_t pos;
+    // the edge goes from the neighbour to the vertex
+    bool in;
+} neighbour;
+
+/**
+ * @brief A generator thread.
+ */
+typedef struct {
+    pthread_t thread;
+    rng_state rng;
+    const csr_graph *graph;
+    const edge_list *fixed;
+} generator_thread;
+
 static int shmFd = -1;
 static cbuf *buf = NULL;
-static sem_t *semUsed = NULL;
-static sem_t *semFree = NULL;
-static sem_t *semMutex = NULL;
-static size_t num_of_edges;
+static size_t bufBytes = 0;
+static size_t batch_size = BATCH_SIZE;
 static size_t num_of_vertices;
+static bool local_search = false;
 
 static const char* PROGRAM_NAME;
 
@@ -56,8 +108,9 @@ static void ERROR_EXIT(char *message, char *error_details) {
  * and then exits the program with a failure status using the exit(EXIT_FAILURE) call.
  */
 static void USAGE() {
-    fprintf(stderr, "Usage: %s EDGE1 EDGE2 ...\n", PROGRAM_NAME);
+    fprintf(stderr, "Usage: %s [-b batch] [-t threads] [-f file] [-l] EDGE1 EDGE2 ...\n", PROGRAM_NAME);
     fprintf(stderr, "Example: %s 0-1 1-2 1-3 1-4 2-4 3-6 4-3 4-5 6-0\n", PROGRAM_NAME);
+    fprintf(stderr, "The file holds edges in the same form, separated by whitespace.\n");
     exit(EXIT_FAILURE);
 }
 
@@ -65,98 +118,125 @@ static void USAGE() {
  * @brief Perform cleanup operations on program shutdown.
  *
  * This function decrements the number of generators in the shared buffer,
- * unmaps shared memory, closes file descriptors, and closes semaphores.
+ * unmaps shared memory and closes file descriptors.
  */
 static void shutdown() {
     if (buf != NULL) {
-        buf->numOfGenerators--;
-        if (munmap(buf, sizeof(*buf)) < 0) {
+        __atomic_fetch_sub(&buf->numOfGenerators, 1, __ATOMIC_SEQ_CST);
+        if (munmap(buf, bufBytes) < 0) {
             ERROR_MSG("Error unmapping shared memory", strerror(errno));
         }
     }
 
-    if (shmFd == -1) {
+    if (shmFd != -1) {
         if (close(shmFd) < 0) {
             ERROR_MSG("Error closing shared memory fd", strerror(errno));
         }
     }
+}
 
-    if (semUsed != NULL) {
-        if (sem_close(semUsed) < 0) {
-            ERROR_MSG("Error closing used", strerror(errno));
+/**
+ * @brief Write a batch of edge_lists to the shared buffer.
+ *
+ * This function claims free slots for the whole batch at once without locking
+ * and writes the `edge_list`s into them, waiting only while the ring is full.
+ *
+ * @param candidates The edge_lists to be written to the shared buffer.
+ * @param stored The number of edge_lists in the batch.
+ * @param generated The number of permutations evaluated for the batch.
+ * @return false if the program is flagged for termination or interrupted, true otherwise.
+ */
+static bool bufferWrite(const edge_list candidates[], size_t stored, long generated) {
+    if (ringWrite(buf, candidates, stored, generated) < 0) {
+        if (errno == ECANCELED || errno == EINTR) {
+            return false;
         }
+        ERROR_EXIT("Error while writing the buffer", strerror(errno));
     }
+    return true;
+}
 
-    if (semFree != NULL) {
-        if (sem_close(semFree) < 0) {
-            ERROR_MSG("Error closing free", strerror(errno));
-        }
-    }
+/**
+ * @brief Rotate a 64 bit value to the left.
+ */
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
 
-    if (semMutex != NULL) {
-        if (sem_post(semMutex) < 0) { // Resolve possible deadlocks
-            ERROR_MSG("Error while sem_post on free", strerror(errno));
-        }
-        if (sem_close(semMutex) < 0) {
-            ERROR_MSG("Error closing mutex", strerror(errno));
-        }
-    }
+/**
+ * @brief Get the next random number of a xoshiro256** generator.
+ *
+ * @param rng The state of the generator.
+ * @return A random 64 bit value.
+ */
+static uint64_t rng_next(rng_state *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
 }
 
 /**
- * @brief Wait for semaphores before writing to the shared buffer.
+ * @brief Seed a xoshiro256** generator, expanding the seed with splitmix64.
  *
- * This function waits for the `semFree` semaphore to ensure there is space
- * in the shared buffer. If the program is flagged for termination, it exits
- * successfully. It also waits for the `semMutex` semaphore to prevent race
- * conditions with other writers.
+ * @param rng The state of the generator.
+ * @param seed The seed.
  */
-static void writeWait() {
-    if (sem_wait(semFree) < 0) {
-        if (errno == EINTR) {
-            exit(EXIT_SUCCESS);
-        }
-        ERROR_EXIT("Error while waiting for free", strerror(errno));
-    }
-    if (buf->terminate) {
-        exit(EXIT_SUCCESS);
-    }
-    if (sem_wait(semMutex)) {
-        if (errno == EINTR) {
-            exit(EXIT_SUCCESS);
-        }
-        ERROR_EXIT("Error while waiting for mutex", strerror(errno));
+static void rng_seed(rng_state *rng, uint64_t seed) {
+    for (size_t i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        rng->s[i] = z ^ (z >> 31);
     }
 }
 
 /**
- * @brief Signal that writing to the shared buffer is complete.
+ * @brief Advance a xoshiro256** generator by 2^128 steps.
+ *
+ * Jumping once per thread gives every thread its own sequence that
+ * does not overlap with the one of any other thread.
  *
- * This function signals the completion of writing by posting to the `semMutex`
- * semaphore and the `semUsed` semaphore to indicate data availability.
+ * @param rng The state of the generator.
  */
-static void writeSignal() {
-    if (sem_post(semMutex) < 0) {
-        ERROR_EXIT("Error while posting mutex", strerror(errno));
-    }
-    if (sem_post(semUsed) < 0) {
-        ERROR_EXIT("Error while posting used", strerror(errno));
+static void rng_jump(rng_state *rng) {
+    static const uint64_t JUMP[] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (JUMP[i] & (1ULL << b)) {
+                for (size_t j = 0; j < 4; j++) {
+                    s[j] ^= rng->s[j];
+                }
+            }
+            rng_next(rng);
+        }
     }
+    memcpy(rng->s, s, sizeof(s));
 }
 
 /**
- * @brief Write an edge_list to the shared buffer.
+ * @brief Get a random number in [0, bound).
  *
- * This function waits for semaphores, writes an `edge_list` to the shared buffer,
- * signals the completion of writing, and releases the semaphores.
+ * Multiplying instead of taking the remainder avoids a division,
+ * the bias is negligible for any realistic number of vertices.
  *
- * @param candidate The edge_list to be written to the shared buffer.
+ * @param rng The state of the generator.
+ * @param bound The exclusive upper bound, less than 2^32.
+ * @return A random number below bound.
  */
-static void bufferWrite(edge_list candidate) {
-    writeWait();
-    buf->data[buf->writePos] = candidate;
-    buf->writePos = (buf->writePos + 1) % BUF_SIZE;
-    writeSignal();
+static size_t rng_below(rng_state *rng, size_t bound) {
+    return (size_t) (((rng_next(rng) >> 32) * (uint64_t) bound) >> 32);
 }
 
 /**
@@ -167,7 +247,7 @@ static void bufferWrite(edge_list candidate) {
  *
  * @param vertices An array to store sequential vertex indices.
  */
-static void fill_vertex_array(long vertices[]) {
+static void fill_vertex_array(uint32_t vertices[]) {
     for (size_t i = 0; i < num_of_vertices; i++) {
         vertices[i] = i;
     }
@@ -177,66 +257,300 @@ static void fill_vertex_array(long vertices[]) {
  * @brief Generate a random permutation of vertex indices.
  *
  * This function generates a random permutation of vertex indices using the Fisher-Yates
- * shuffle algorithm.
+ * shuffle algorithm. Shuffling any permutation again gives a uniformly random one,
+ * so the array does not have to be refilled in between.
  *
- * @param vertices An array containing sequential vertex indices.
+ * @param vertices An array containing a permutation of the vertex indices.
+ * @param rng The random number generator of the calling thread.
  */
-static void generate_random_permutation(long vertices[]) {
-    for (size_t i = num_of_vertices - 1; i > 0; i--) {
-        long j = rand() % (i + 1);
-        long temp = vertices[j];
-        vertices[j] = vertices[i];
-        vertices[i] = temp;
+static void generate_random_permutation(uint32_t vertices[], rng_state *rng) {
+    for (size_t i = num_of_vertices; i > 1; i--) {
+        size_t j = rng_below(rng, i);
+        uint32_t temp = vertices[j];
+        vertices[j] = vertices[i - 1];
+        vertices[i - 1] = temp;
     }
 }
 
 
+/**
+ * @brief Count the edges pointing backwards in an order.
+ *
+ * @param graph The graph.
+ * @param pos The position of every vertex in the order.
+ * @return The number of edges from a later to an earlier vertex.
+ */
+static size_t count_back_edges(const csr_graph *graph, const uint32_t pos[]) {
+    size_t count = 0;
+    for (uint32_t u = 0; u < num_of_vertices; u++) {
+        uint32_t pos_u = pos[u];
+        for (uint32_t i = graph->offsets[u]; i < graph->offsets[u + 1]; i++) {
+            count += pos_u > pos[graph->targets[i]];
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Compare two neighbours by their position.
+ */
+static int compare_neighbours(const void *a, const void *b) {
+    const neighbour *n1 = a;
+    const neighbour *n2 = b;
+    return (n1->pos < n2->pos) ? -1 : (n1->pos > n2->pos);
+}
+
+/**
+ * @brief Move a vertex to another position, shifting the vertices in between by one.
+ *
+ * @param order The vertex at every position.
+ * @param pos The position of every vertex.
+ * @param from The current position of the vertex.
+ * @param to The new position of the vertex.
+ */
+static void move_vertex(uint32_t order[], uint32_t pos[], uint32_t from, uint32_t to) {
+    uint32_t v = order[from];
+    if (to < from) {
+        for (uint32_t i = from; i > to; i--) {
+            order[i] = order[i - 1];
+            pos[order[i]] = i;
+        }
+    } else {
+        for (uint32_t i = from; i < to; i++) {
+            order[i] = order[i + 1];
+            pos[order[i]] = i;
+        }
+    }
+    order[to] = v;
+    pos[v] = to;
+}
+
+/**
+ * @brief Move a vertex to the position that removes the most back edges.
+ *
+ * Only passing a neighbour changes the number of back edges: passing it to the
+ * left turns an edge entering the vertex backwards and an edge leaving it forwards,
+ * passing it to the right does the opposite. So it is enough to walk the neighbours
+ * sorted by their position away from the vertex in both directions.
+ *
+ * @param graph The graph.
+ * @param order The vertex at every position.
+ * @param pos The position of every vertex.
+ * @param v The vertex to move.
+ * @param neighbours Scratch space for max_degree neighbours.
+ * @return By how much the number of back edges changed, 0 if the vertex stayed.
+ */
+static long sift_vertex(const csr_graph *graph, uint32_t order[], uint32_t pos[], uint32_t v,
+                        neighbour neighbours[]) {
+    uint32_t from = pos[v];
+    size_t count = 0;
+    for (uint32_t i = graph->offsets[v]; i < graph->offsets[v + 1]; i++) {
+        neighbours[count].pos = pos[graph->targets[i]];
+        neighbours[count++].in = false;
+    }
+    for (uint32_t i = graph->in_offsets[v]; i < graph->in_offsets[v + 1]; i++) {
+        neighbours[count].pos = pos[graph->sources[i]];
+        neighbours[count++].in = true;
+    }
+    qsort(neighbours, count, sizeof(neighbour), compare_neighbours);
+
+    size_t split = 0;
+    while (split < count && neighbours[split].pos < from) {
+        split++;
+    }
+
+    long best = 0;
+    uint32_t to = from;
+
+    // to the left, the vertex can only go in front of all neighbours at the same position
+    long change = 0;
+    for (size_t i = split; i > 0; i--) {
+        change += neighbours[i - 1].in ? 1 : -1;
+        if ((i == 1 || neighbours[i - 2].pos != neighbours[i - 1].pos) && change < best) {
+            best = change;
+            to = neighbours[i - 1].pos;
+        }
+    }
+
+    // to the right, skipping self loops
+    change = 0;
+    size_t i = split;
+    while (i < count && neighbours[i].pos == from) {
+        i++;
+    }
+    for (; i < count; i++) {
+        change += neighbours[i].in ? -1 : 1;
+        if ((i + 1 == count || neighbours[i + 1].pos != neighbours[i].pos) && change < best) {
+            best = change;
+            to = neighbours[i].pos;
+        }
+    }
+
+    if (to != from) {
+        move_vertex(order, pos, from, to);
+    }
+    return best;
+}
+
+/**
+ * @brief Improve an order by moving single vertices until no move removes a back edge.
+ *
+ * @param graph The graph.
+ * @param order The vertex at every position.
+ * @param pos The position of every vertex.
+ * @param neighbours Scratch space for max_degree neighbours.
+ * @param back_edges The number of back edges of the order, updated to the one of the improved order.
+ */
+static void improve_order(const csr_graph *graph, uint32_t order[], uint32_t pos[], neighbour neighbours[],
+                          size_t *back_edges) {
+    bool improved = true;
+    while (improved && *back_edges > 0 && __atomic_load_n(&buf->terminate, __ATOMIC_RELAXED) == 0) {
+        improved = false;
+        // a pass over a large graph takes long, so termination is checked for every vertex
+        for (uint32_t v = 0; v < num_of_vertices && __atomic_load_n(&buf->terminate, __ATOMIC_RELAXED) == 0; v++) {
+            long change = sift_vertex(graph, order, pos, v, neighbours);
+            if (change < 0) {
+                *back_edges -= (size_t) -change;
+                improved = true;
+            }
+        }
+    }
+}
+
 /**
  * @brief Generate and buffer solutions based on random permutations of edges.
  *
  * This function generates solutions by creating random permutations of vertex indices,
  * applying a random permutation to the given edges, and buffering a solution if
- * certain conditions are met.
+ * certain conditions are met. Solutions are collected locally and written to the
+ * shared buffer once per batch, only the best solution of a batch is kept since the
+ * supervisor would discard the others. A permutation is abandoned as soon as it
+ * removes as many edges as the best solution of the supervisor or of this generator,
+ * or more edges than the supervisor accepts. With local search every permutation
+ * is first improved to a local optimum, where no single vertex can be moved to
+ * remove another back edge. Every solution starts with the fixed edges of the
+ * components solved exactly.
+ *
+ * The function returns once the program is flagged for termination.
  *
- * @param edges An array of edges to generate solutions from.
+ * @param graph The graph to generate solutions for.
+ * @param fixed The edges every solution removes.
+ * @param rng The random number generator of the calling thread.
  */
-static void generate_solutions(edge edges[]) {
-    while (buf->terminate == 0) {
-        long random_permutation[num_of_vertices];
-        fill_vertex_array(random_permutation);
-        generate_random_permutation(random_permutation);
+static void generate_solutions(const csr_graph *graph, const edge_list *fixed, rng_state *rng) {
+    // a permutation is abandoned once it removes one edge more than a slot can hold
+    size_t max_edges = buf->maxEdges;
+    size_t room = ((fixed->stored > max_edges) ? fixed->stored : max_edges) + 1;
+    edge_list tmp = { .list = malloc(sizeof(edge) * room), .stored = 0 };
+    edge_list batch = { .list = malloc(sizeof(edge) * room), .stored = 0 };
+    uint32_t *random_permutation = malloc(sizeof(uint32_t) * num_of_vertices);
+    uint32_t *order = NULL;
+    neighbour *neighbours = NULL;
+    if (local_search) {
+        order = malloc(sizeof(uint32_t) * num_of_vertices);
+        neighbours = malloc(sizeof(neighbour) * (graph->max_degree + 1));
+    }
+    if (tmp.list == NULL || batch.list == NULL || random_permutation == NULL ||
+        (local_search && (order == NULL || neighbours == NULL))) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+    size_t stored = 0;
+    size_t generated = 0;
+    size_t best = SIZE_MAX;
+    fill_vertex_array(random_permutation);
+    // the fixed edges never get overwritten, only the edges behind them
+    memcpy(tmp.list, fixed->list, sizeof(edge) * fixed->stored);
+    memcpy(batch.list, fixed->list, sizeof(edge) * fixed->stored);
+
+    while (__atomic_load_n(&buf->terminate, __ATOMIC_RELAXED) == 0) {
+        generate_random_permutation(random_permutation, rng);
 
-        edge_list tmp;
-        size_t delete_counter = 0;
-        tmp.stored = 0;
+        // only solutions smaller than every solution found so far are of any use
+        size_t bound = __atomic_load_n(&buf->bestSolution, __ATOMIC_RELAXED);
+        if (best < bound) {
+            bound = best;
+        }
+        if (bound > max_edges + 1) {
+            bound = max_edges + 1;
+        }
 
-        for (size_t i = 0; i < num_of_edges && delete_counter < 7; i++) {
-            size_t pos_u = random_permutation[edges[i].u];
-            size_t pos_v = random_permutation[edges[i].v];
+        if (local_search) {
+            for (uint32_t v = 0; v < num_of_vertices; v++) {
+                order[random_permutation[v]] = v;
+            }
+            size_t back_edges = count_back_edges(graph, random_permutation);
+            improve_order(graph, order, random_permutation, neighbours, &back_edges);
+            if (fixed->stored + back_edges >= bound) {
+                // no need to collect the edges of a solution that would be dropped anyway
+                bound = 0;
+            }
+        }
 
-            if (pos_u > pos_v) {
-                tmp.list[delete_counter++] = edges[i];
-                tmp.stored = delete_counter;
+        // an edge pointing backwards in the order has to be removed
+        tmp.stored = fixed->stored;
+        for (uint32_t u = 0; u < num_of_vertices && tmp.stored < bound; u++) {
+            uint32_t pos_u = random_permutation[u];
+            for (uint32_t i = graph->offsets[u]; i < graph->offsets[u + 1]; i++) {
+                uint32_t v = graph->targets[i];
+                if (pos_u > random_permutation[v]) {
+                    tmp.list[tmp.stored].u = graph->ids[u];
+                    tmp.list[tmp.stored].v = graph->ids[v];
+                    if (++tmp.stored == bound) {
+                        break;
+                    }
+                }
             }
         }
 
-        if (delete_counter < 7) {
-            bufferWrite(tmp);
-            // another funny place
+        generated++;
+        if (tmp.stored < bound) {
+            // it is better than everything else in the batch, so it replaces it
+            edge *list = batch.list;
+            batch = tmp;
+            tmp.list = list;
+            best = batch.stored;
+            stored = 1;
+        }
+        if (generated == batch_size || best == 0) {
+            if (!bufferWrite(&batch, stored, (long) generated)) {
+                break;
+            }
+            stored = 0;
+            generated = 0;
         }
     }
+    free(tmp.list);
+    free(batch.list);
+    free(random_permutation);
+    free(order);
+    free(neighbours);
+}
+
+/**
+ * @brief Entry point of a generator thread.
+ *
+ * @param arg The generator_thread to run.
+ * @return NULL
+ */
+static void *generate_thread(void *arg) {
+    generator_thread *self = arg;
+    generate_solutions(self->graph, self->fixed, &self->rng);
+    return NULL;
 }
 
 /**
- * @brief Get a random seed based on the current time, clock, and process ID.
+ * @brief Get a random seed based on the current time and process ID.
  *
- * This function generates a random seed by combining the current time, clock, and
- * process ID. It can be used for seeding random number generation functions.
+ * This function generates a random seed by combining the current time in
+ * nanoseconds and the process ID, so generators started at the same time
+ * still get different seeds.
  *
- * @return An unsigned integer representing the random seed.
+ * @return A 64 bit random seed.
  */
-static unsigned int get_random_seed() {
-    return time(NULL) * clock() * getpid();
+static uint64_t get_random_seed() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return ((uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec) ^ ((uint64_t) getpid() << 32);
 }
 
 
@@ -244,7 +558,7 @@ static unsigned int get_random_seed() {
  * @brief Perform startup operations for the generator process.
  *
  * This function sets up cleanup operations, opens shared memory, maps shared
- * memory, closes file descriptors, and opens semaphores for the generator process.
+ * memory and closes file descriptors for the generator process.
  */
 static void startup() {
     if (atexit(shutdown) < 0) {
@@ -259,34 +573,29 @@ static void startup() {
         ERROR_EXIT("Error opening shared memory", strerror(errno));
     }
 
+    // the size of the ring is chosen by the supervisor
+    struct stat info;
+    if (fstat(shmFd, &info) < 0) {
+        ERROR_EXIT("Error reading size of shared memory", strerror(errno));
+    }
+    bufBytes = info.st_size;
+
     // map shared memory object
-    buf = mmap(NULL, sizeof(*buf), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    buf = mmap(NULL, bufBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
     if (buf == MAP_FAILED) {
+        buf = NULL; // keep shutdown from touching it
         ERROR_EXIT("Error mapping shared memory", strerror(errno));
     }
+    if (bufBytes < sizeof(cbuf) || bufBytes < ringBytes(buf->size, buf->maxEdges)) {
+        ERROR_EXIT("Shared memory is too small for the ring", NULL);
+    }
 
     if (close(shmFd) < 0) {
         ERROR_EXIT("Error closing shared memory fd", strerror(errno));
     }
     shmFd = -1;
 
-    // open semaphores
-    semUsed = sem_open(SEM_USED, 0);
-    if (semUsed == SEM_FAILED) {
-        ERROR_EXIT("Error opening used", strerror(errno));
-    }
-
-    semFree = sem_open(SEM_FREE, 0);
-    if (semFree == SEM_FAILED) {
-        ERROR_EXIT("Error opening free", strerror(errno));
-    }
-
-    semMutex = sem_open(SEM_MUTEX, 0);
-    if (semMutex == SEM_FAILED) {
-        ERROR_EXIT("Error opening mutex", strerror(errno));
-    }
-
-    buf->numOfGenerators++;
+    __atomic_fetch_add(&buf->numOfGenerators, 1, __ATOMIC_SEQ_CST);
 }
 
 /**
@@ -316,9 +625,9 @@ static edge parseEdge(const char *input) {
         USAGE();
     }
 
-    if (u == LONG_MIN || u == LONG_MAX) {
+    if (u == LONG_MIN || u == LONG_MAX || u >= UINT32_MAX) {
         free(tmp);
-        ERROR_EXIT("Overflow occurred while parsing vertex index", strerror(errno));
+        ERROR_EXIT("Overflow occurred while parsing vertex index", strerror(ERANGE));
     }
 
     if (endptr[0] != '-') {
@@ -342,9 +651,9 @@ static edge parseEdge(const char *input) {
         USAGE();
     }
 
-    if (v == LONG_MIN || v == LONG_MAX) {
+    if (v == LONG_MIN || v == LONG_MAX || v >= UINT32_MAX) {
         free(tmp);
-        ERROR_EXIT("Overflow occurred while parsing vertex index", strerror(errno));
+        ERROR_EXIT("Overflow occurred while parsing vertex index", strerror(ERANGE));
     }
 
     if (endptr[0] != '\0') {
@@ -370,28 +679,400 @@ static edge parseEdge(const char *input) {
         num_of_vertices = v + 1;
     }
 
-    edge e = {.u = u, .v = v};
+    edge e = {.u = (uint32_t) u, .v = (uint32_t) v};
     return e;
 }
 
+/**
+ * @brief Append an edge to a growing list of edges.
+ *
+ * @param edges The list of edges.
+ * @param capacity The number of edges the list has room for.
+ * @param e The edge to append.
+ */
+static void add_edge(edge_list *edges, size_t *capacity, edge e) {
+    if (edges->stored == *capacity) {
+        *capacity = (*capacity == 0) ? 1024 : *capacity * 2;
+        edge *list = realloc(edges->list, sizeof(edge) * *capacity);
+        if (list == NULL) {
+            ERROR_EXIT("Error allocating memory", strerror(errno));
+        }
+        edges->list = list;
+    }
+    edges->list[edges->stored++] = e;
+}
+
 /**
  * @brief Parse command line input to extract edge information.
  *
  * This function parses the command line input to extract edge information. It
  * uses the parseEdge function to handle individual edges.
  *
- * @param argc The number of command line arguments.
- * @param argv An array of command line argument strings.
- * @param edges An array to store parsed edge information.
+ * @param count The number of edge arguments.
+ * @param args An array of edge argument strings.
+ * @param edges The list to append the parsed edges to.
+ * @param capacity The number of edges the list has room for.
  */
-static void parseInput(int argc, const char **argv, edge edges[]) {
-    if (argc < 2) {
-        USAGE();
+static void parseInput(size_t count, const char **args, edge_list *edges, size_t *capacity) {
+    for (size_t i = 0; i < count; i++) {
+        add_edge(edges, capacity, parseEdge(args[i]));
+    }
+}
+
+/**
+ * @brief Read edges separated by whitespace from a file.
+ *
+ * @param path The path of the file.
+ * @param edges The list to append the parsed edges to.
+ * @param capacity The number of edges the list has room for.
+ */
+static void parseFile(const char *path, edge_list *edges, size_t *capacity) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        ERROR_EXIT("Error opening edge file", strerror(errno));
     }
 
-    for (size_t i = 1; i < argc; i++) {
-        edges[i - 1] = parseEdge(argv[i]);
+    // the largest edge is 4294967294-4294967294, anything longer is split up and rejected
+    char token[64];
+    while (fscanf(file, "%63s", token) == 1) {
+        add_edge(edges, capacity, parseEdge(token));
+    }
+    if (ferror(file)) {
+        ERROR_EXIT("Error reading edge file", strerror(errno));
+    }
+    fclose(file);
+}
+
+/**
+ * @brief Compare two edges by their source and then their target vertex.
+ */
+static int compare_edges(const void *a, const void *b) {
+    const edge *e1 = a;
+    const edge *e2 = b;
+    if (e1->u != e2->u) {
+        return (e1->u < e2->u) ? -1 : 1;
     }
+    return (e1->v < e2->v) ? -1 : (e1->v > e2->v);
+}
+
+/**
+ * @brief Build the compressed sparse row form of the graph.
+ *
+ * The edges entering the vertices are only built if local search needs them.
+ *
+ * @param edges The edges of the graph, they get sorted.
+ * @param graph The graph to build.
+ * @param incoming Whether to build the edges entering the vertices as well.
+ */
+static void build_graph(edge_list *edges, csr_graph *graph, bool incoming) {
+    if (edges->stored > UINT32_MAX) {
+        ERROR_EXIT("Too many edges", NULL);
+    }
+    qsort(edges->list, edges->stored, sizeof(edge), compare_edges);
+
+    graph->offsets = calloc(num_of_vertices + 1, sizeof(uint32_t));
+    graph->targets = malloc(sizeof(uint32_t) * (edges->stored + 1));
+    if (graph->offsets == NULL || graph->targets == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+
+    for (size_t i = 0; i < edges->stored; i++) {
+        graph->offsets[edges->list[i].u + 1]++;
+        graph->targets[i] = edges->list[i].v;
+    }
+    for (size_t u = 0; u < num_of_vertices; u++) {
+        graph->offsets[u + 1] += graph->offsets[u];
+    }
+
+    graph->in_offsets = NULL;
+    graph->sources = NULL;
+    graph->max_degree = 0;
+    graph->ids = NULL;
+    if (!incoming) {
+        return;
+    }
+
+    graph->in_offsets = calloc(num_of_vertices + 1, sizeof(uint32_t));
+    graph->sources = malloc(sizeof(uint32_t) * (edges->stored + 1));
+    uint32_t *next = malloc(sizeof(uint32_t) * (num_of_vertices + 1));
+    if (graph->in_offsets == NULL || graph->sources == NULL || next == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+
+    for (size_t i = 0; i < edges->stored; i++) {
+        graph->in_offsets[edges->list[i].v + 1]++;
+    }
+    for (size_t v = 0; v < num_of_vertices; v++) {
+        graph->in_offsets[v + 1] += graph->in_offsets[v];
+    }
+    // the edges are sorted by source, so the sources of every vertex end up sorted as well
+    memcpy(next, graph->in_offsets, sizeof(uint32_t) * (num_of_vertices + 1));
+    for (size_t i = 0; i < edges->stored; i++) {
+        graph->sources[next[edges->list[i].v]++] = edges->list[i].u;
+    }
+    free(next);
+
+    for (size_t v = 0; v < num_of_vertices; v++) {
+        size_t degree = (graph->offsets[v + 1] - graph->offsets[v]) + (graph->in_offsets[v + 1] - graph->in_offsets[v]);
+        if (degree > graph->max_degree) {
+            graph->max_degree = degree;
+        }
+    }
+}
+
+/**
+ * @brief Find the strongly connected components of a graph with Tarjan's algorithm.
+ *
+ * The depth first search keeps its own stack instead of recursing, so long
+ * paths can not overflow the stack of the thread. A vertex that has been
+ * visited but has no component yet is still on the stack of the algorithm.
+ *
+ * @param graph The graph, only the edges leaving the vertices are used.
+ * @param component Where to store the component of every vertex.
+ * @return The number of components.
+ */
+static uint32_t find_components(const csr_graph *graph, uint32_t component[]) {
+    uint32_t *index = malloc(sizeof(uint32_t) * num_of_vertices);
+    uint32_t *low = malloc(sizeof(uint32_t) * num_of_vertices);
+    uint32_t *next_edge = malloc(sizeof(uint32_t) * num_of_vertices);
+    uint32_t *stack = malloc(sizeof(uint32_t) * num_of_vertices);
+    uint32_t *path = malloc(sizeof(uint32_t) * num_of_vertices);
+    if (index == NULL || low == NULL || next_edge == NULL || stack == NULL || path == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+    for (uint32_t v = 0; v < num_of_vertices; v++) {
+        index[v] = UINT32_MAX;
+        component[v] = UINT32_MAX;
+    }
+
+    uint32_t components = 0;
+    uint32_t visited = 0;
+    size_t stored = 0;
+    for (uint32_t root = 0; root < num_of_vertices; root++) {
+        if (index[root] != UINT32_MAX) {
+            continue;
+        }
+
+        size_t depth = 0;
+        path[depth++] = root;
+        index[root] = low[root] = visited++;
+        next_edge[root] = graph->offsets[root];
+        stack[stored++] = root;
+
+        while (depth > 0) {
+            uint32_t v = path[depth - 1];
+            if (next_edge[v] < graph->offsets[v + 1]) {
+                uint32_t w = graph->targets[next_edge[v]++];
+                if (index[w] == UINT32_MAX) {
+                    path[depth++] = w;
+                    index[w] = low[w] = visited++;
+                    next_edge[w] = graph->offsets[w];
+                    stack[stored++] = w;
+                } else if (component[w] == UINT32_MAX && index[w] < low[v]) {
+                    low[v] = index[w];
+                }
+                continue;
+            }
+
+            // all edges of v are done, hand its lowest reachable index to its parent
+            depth--;
+            if (depth > 0 && low[v] < low[path[depth - 1]]) {
+                low[path[depth - 1]] = low[v];
+            }
+            if (low[v] == index[v]) {
+                uint32_t w;
+                do {
+                    w = stack[--stored];
+                    component[w] = components;
+                } while (w != v);
+                components++;
+            }
+        }
+    }
+
+    free(index);
+    free(low);
+    free(next_edge);
+    free(stack);
+    free(path);
+    return components;
+}
+
+/**
+ * @brief Find an order of a small component that removes as few edges as possible.
+ *
+ * best[S] is the smallest number of back edges of any order of the vertices in
+ * the subset S. Putting a vertex v behind all of S turns exactly the edges from
+ * v into S backwards, so every subset is solved from the subsets one vertex smaller.
+ *
+ * @param edges The edges inside the component.
+ * @param stored The number of edges.
+ * @param size The number of vertices of the component, at most EXACT_VERTICES.
+ * @param local The index of every vertex within its component.
+ * @param fixed The list to append the edges to that the best order removes.
+ * @param capacity The number of edges the list has room for.
+ */
+static void solve_component(const edge edges[], size_t stored, size_t size, const uint32_t local[],
+                            edge_list *fixed, size_t *capacity) {
+    // parallel edges are counted, a mask per vertex keeps the inner loop short
+    uint32_t count[EXACT_VERTICES][EXACT_VERTICES];
+    uint32_t mask[EXACT_VERTICES];
+    memset(count, 0, sizeof(count));
+    memset(mask, 0, sizeof(mask));
+    for (size_t i = 0; i < stored; i++) {
+        uint32_t u = local[edges[i].u];
+        uint32_t v = local[edges[i].v];
+        count[u][v]++;
+        mask[u] |= 1u << v;
+    }
+
+    size_t subsets = (size_t) 1 << size;
+    uint32_t *best = malloc(sizeof(uint32_t) * subsets);
+    uint8_t *last = malloc(sizeof(uint8_t) * subsets);
+    if (best == NULL || last == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+    best[0] = 0;
+    for (size_t s = 1; s < subsets; s++) {
+        best[s] = UINT32_MAX;
+    }
+
+    for (size_t s = 0; s < subsets; s++) {
+        for (uint32_t v = 0; v < size; v++) {
+            if (s & (1u << v)) {
+                continue;
+            }
+            uint32_t cost = best[s];
+            for (uint32_t m = mask[v] & s; m != 0; m &= m - 1) {
+                cost += count[v][__builtin_ctz(m)];
+            }
+            size_t t = s | (1u << v);
+            if (cost < best[t]) {
+                best[t] = cost;
+                last[t] = v;
+            }
+        }
+    }
+
+    // walk back from the whole component to find the position of every vertex
+    uint32_t pos[EXACT_VERTICES];
+    size_t s = subsets - 1;
+    for (size_t i = size; i > 0; i--) {
+        uint32_t v = last[s];
+        pos[v] = i - 1;
+        s &= ~((size_t) 1 << v);
+    }
+    free(best);
+    free(last);
+
+    for (size_t i = 0; i < stored; i++) {
+        if (pos[local[edges[i].u]] > pos[local[edges[i].v]]) {
+            add_edge(fixed, capacity, edges[i]);
+        }
+    }
+}
+
+/**
+ * @brief Shrink the graph to the parts that are left for the random search.
+ *
+ * An edge between two strongly connected components is never on a cycle, ordering
+ * the components topologically keeps all of these edges. A self loop always has to be
+ * removed. Components of at most EXACT_VERTICES vertices are solved exactly, the edges
+ * removed by all of this are the same for every solution. The vertices of the remaining
+ * components get numbered from 0 again and num_of_vertices becomes their number.
+ *
+ * @param edges The edges of the graph, replaced by the edges inside the remaining components.
+ * @param fixed The list to append the edges to that every solution removes.
+ * @return The index every remaining vertex had in the input.
+ */
+static uint32_t *reduce_graph(edge_list *edges, edge_list *fixed) {
+    csr_graph full;
+    build_graph(edges, &full, false);
+
+    uint32_t *component = malloc(sizeof(uint32_t) * num_of_vertices);
+    uint32_t *local = malloc(sizeof(uint32_t) * num_of_vertices);
+    uint32_t *ids = malloc(sizeof(uint32_t) * (num_of_vertices + 1));
+    if (component == NULL || local == NULL || ids == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+    uint32_t components = find_components(&full, component);
+    free(full.offsets);
+    free(full.targets);
+
+    uint32_t *size = calloc(components, sizeof(uint32_t));
+    uint32_t *start = calloc((size_t) components + 1, sizeof(uint32_t));
+    if (size == NULL || start == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+    for (uint32_t v = 0; v < num_of_vertices; v++) {
+        size[component[v]]++;
+    }
+
+    // vertices of large components get their new index, the others one within their component
+    uint32_t remaining = 0;
+    for (uint32_t v = 0; v < num_of_vertices; v++) {
+        uint32_t c = component[v];
+        if (size[c] > EXACT_VERTICES) {
+            ids[remaining] = v;
+            local[v] = remaining++;
+        } else {
+            local[v] = start[c]++;
+        }
+    }
+
+    // group the edges of the small components by component, keeping their order
+    memset(start, 0, sizeof(uint32_t) * ((size_t) components + 1));
+    for (size_t i = 0; i < edges->stored; i++) {
+        edge e = edges->list[i];
+        uint32_t c = component[e.u];
+        if (e.u != e.v && c == component[e.v] && size[c] <= EXACT_VERTICES) {
+            start[c + 1]++;
+        }
+    }
+    for (uint32_t c = 0; c < components; c++) {
+        start[c + 1] += start[c];
+    }
+    edge *small = malloc(sizeof(edge) * (start[components] + 1));
+    uint32_t *next = malloc(sizeof(uint32_t) * ((size_t) components + 1));
+    if (small == NULL || next == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+    memcpy(next, start, sizeof(uint32_t) * ((size_t) components + 1));
+
+    size_t capacity = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < edges->stored; i++) {
+        edge e = edges->list[i];
+        uint32_t c = component[e.u];
+        if (e.u == e.v) {
+            add_edge(fixed, &capacity, e);
+        } else if (c != component[e.v]) {
+            continue;
+        } else if (size[c] <= EXACT_VERTICES) {
+            small[next[c]++] = e;
+        } else {
+            // kept never passes i, so the list can be compacted in place
+            edges->list[kept].u = local[e.u];
+            edges->list[kept].v = local[e.v];
+            kept++;
+        }
+    }
+    edges->stored = kept;
+
+    for (uint32_t c = 0; c < components; c++) {
+        if (start[c + 1] > start[c]) {
+            solve_component(small + start[c], start[c + 1] - start[c], size[c], local, fixed, &capacity);
+        }
+    }
+
+    free(component);
+    free(local);
+    free(size);
+    free(start);
+    free(small);
+    free(next);
+    num_of_vertices = remaining;
+    return ids;
 }
 
 /**
@@ -403,17 +1084,128 @@ static void parseInput(int argc, const char **argv, edge edges[]) {
 int main(int argc, const char** argv) {
     PROGRAM_NAME = argv[0];
 
+    int opt;
+    char *endptr;
+    long value;
+    size_t threads = 1;
+    const char *file = NULL;
+
+    while ((opt = getopt(argc, (char **) argv, "b:t:f:l")) != -1) {
+        switch (opt) {
+            case 'b':
+                errno = 0; // Reset errno before calling strtol
+                value = strtol(optarg, &endptr, 10);
+
+                // Check for conversion errors
+                if (errno != 0 || *endptr != '\0' || value <= 0) {
+                    fprintf(stderr, "Invalid number for -b option\n");
+                    exit(EXIT_FAILURE);
+                }
+                batch_size = value;
+                break;
+            case 't':
+                errno = 0; // Reset errno before calling strtol
+                value = strtol(optarg, &endptr, 10);
+
+                // Check for conversion errors
+                if (errno != 0 || *endptr != '\0' || value <= 0 || value > 1024) {
+                    fprintf(stderr, "Invalid number for -t option\n");
+                    exit(EXIT_FAILURE);
+                }
+                threads = value;
+                break;
+            case 'f':
+                file = optarg;
+                break;
+            case 'l':
+                local_search = true;
+                break;
+            default:
+                USAGE();
+        }
+    }
+
+    // parse input
+    edge_list edges = { .list = NULL, .stored = 0 };
+    size_t capacity = 0;
+    parseInput(argc - optind, argv + optind, &edges, &capacity);
+    if (file != NULL) {
+        parseFile(file, &edges, &capacity);
+    }
+    if (edges.stored == 0) {
+        USAGE();
+    }
+
+    // only the components that are too large to solve exactly are left to search
+    edge_list fixed = { .list = NULL, .stored = 0 };
+    uint32_t *ids = reduce_graph(&edges, &fixed);
+    csr_graph graph;
+    build_graph(&edges, &graph, local_search);
+    graph.ids = ids;
+    free(edges.list);
+
     // initialise resources
     startup();
 
-    // parse input
-    num_of_edges = argc-1;
-    edge edges[num_of_edges];
-    parseInput(argc, argv, edges);
+    // every solution removes the fixed edges, if they do not fit no candidate ever will
+    if (fixed.stored > buf->maxEdges) {
+        fprintf(stderr, "[%s]: Every solution removes at least %zu edges, more than the %zu of the supervisor\n",
+                PROGRAM_NAME, fixed.stored, buf->maxEdges);
+        __atomic_store_n(&buf->unsolvable, 1, __ATOMIC_SEQ_CST);
+        ringTerminate(buf);
+        exit(EXIT_FAILURE);
+    }
+
+    // every component was solved exactly, so the fixed edges already are an optimal solution
+    if (num_of_vertices == 0) {
+        if (bufferWrite(&fixed, 1, 1)) {
+            __atomic_store_n(&buf->optimal, 1, __ATOMIC_SEQ_CST);
+            ringTerminate(buf);
+        }
+        free(graph.offsets);
+        free(graph.targets);
+        free(graph.in_offsets);
+        free(graph.sources);
+        free(graph.ids);
+        free(fixed.list);
+        exit(EXIT_SUCCESS);
+    }
 
-    // generate solution
-    srand(get_random_seed());
-    generate_solutions(edges);
+    generator_thread *workers = malloc(sizeof(generator_thread) * threads);
+    if (workers == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+    rng_state rng;
+    rng_seed(&rng, get_random_seed());
+
+    // generate solution, the threads only stop once the buffer is flagged for termination
+    for (size_t i = 0; i < threads; i++) {
+        workers[i].rng = rng;
+        workers[i].graph = &graph;
+        workers[i].fixed = &fixed;
+        rng_jump(&rng);
+
+        int error = pthread_create(&workers[i].thread, NULL, generate_thread, &workers[i]);
+        if (error != 0) {
+            if (i == 0) {
+                ERROR_EXIT("Error creating thread", strerror(error));
+            }
+            // exiting would unmap the buffer under the running threads, carry on with them instead
+            ERROR_MSG("Error creating thread", strerror(error));
+            threads = i;
+            break;
+        }
+    }
+    for (size_t i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    free(workers);
+    free(graph.offsets);
+    free(graph.targets);
+    free(graph.in_offsets);
+    free(graph.sources);
+    free(graph.ids);
+    free(fixed.list);
 
     exit(EXIT_SUCCESS);
 }
\ No newline at end of file
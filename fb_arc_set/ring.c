@@ -0,0 +1,226 @@
+/**
+ * @file ring.c
+ * @author Ivan Cankov 12219400
+ * @date 17.10.2026
+ * @brief OSUE Exercise 2 fb_arc_set
+ * @details Lock-free ring buffer in the shared memory, written by many
+ * generators and read by the supervisor.
+ * Every slot carries a sequence number that tells whose turn it is:
+ * a generator may write the slot at position pos once its sequence is pos,
+ * the supervisor may read it once its sequence is pos + 1. Generators claim
+ * a whole batch of positions with one compare and swap on writePos, so no
+ * generator ever waits for another one, and the supervisor frees everything
+ * it found in one go. A process only sleeps on a futex when the ring is empty
+ * (supervisor) or full (generators), and the other side only makes the wake
+ * up syscall if somebody is actually sleeping.
+ * Slots have room for the largest solution the supervisor accepts, which is
+ * chosen when the shared memory is created, so their size is only known at runtime.
+ */
+
+#include "utils.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/**
+ * @brief Sleep until the futex word no longer holds the given value.
+ *
+ * @param futex the futex word in the shared memory
+ * @param value the value the futex word had before the last check
+ * @return 0 if woken up or the value changed, -1 if interrupted by a signal
+ */
+static int futexWait(unsigned int *futex, unsigned int value) {
+    if (syscall(SYS_futex, futex, FUTEX_WAIT, value, NULL, NULL, 0) < 0) {
+        if (errno == EAGAIN) {
+            return 0;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Wake up processes sleeping on the futex word.
+ *
+ * @param futex the futex word in the shared memory
+ * @param count how many processes to wake up at most
+ */
+static void futexWake(unsigned int *futex, int count) {
+    __atomic_fetch_add(futex, 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, futex, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+/**
+ * @brief Wake up the sleepers of a futex word, if there are any.
+ *
+ * The fence orders the changes of the caller before the check for sleepers,
+ * and a sleeper registers itself before checking the ring a last time, so
+ * either the sleeper sees the change or this sees the sleeper.
+ *
+ * @param futex the futex word in the shared memory
+ * @param waiters the number of processes sleeping on the futex word
+ * @param count how many processes to wake up at most
+ */
+static void ringWake(unsigned int *futex, unsigned int *waiters, int count) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_RELAXED) > 0) {
+        futexWake(futex, count);
+    }
+}
+
+/**
+ * @brief Sleep until the sequence number of a slot changes.
+ *
+ * @param buf the shared buffer
+ * @param sequence the sequence number of the slot
+ * @param expected the sequence number the slot had before
+ * @param futex the futex word that gets bumped when the slot changes
+ * @param waiters the number of processes sleeping on the futex word
+ * @return 0 if the slot might have changed, -1 if interrupted by a signal
+ */
+static int ringSleep(cbuf *buf, uint64_t *sequence, uint64_t expected, unsigned int *futex, unsigned int *waiters) {
+    unsigned int value = __atomic_load_n(futex, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(waiters, 1, __ATOMIC_SEQ_CST);
+
+    int result = 0;
+    if (__atomic_load_n(sequence, __ATOMIC_SEQ_CST) == expected &&
+        __atomic_load_n(&buf->terminate, __ATOMIC_SEQ_CST) == 0) {
+        result = futexWait(futex, value);
+    }
+
+    __atomic_fetch_sub(waiters, 1, __ATOMIC_SEQ_CST);
+    return result;
+}
+
+/**
+ * @brief Get the slot of a position.
+ *
+ * @param buf the shared buffer
+ * @param pos the position
+ * @return the slot the position maps to
+ */
+static slot *ringSlot(cbuf *buf, uint64_t pos) {
+    size_t stride = sizeof(slot) + buf->maxEdges * sizeof(edge);
+    return (slot *) ((char *) buf->data + (pos % buf->size) * stride);
+}
+
+size_t ringBytes(size_t slots, size_t maxEdges) {
+    return sizeof(cbuf) + slots * (sizeof(slot) + maxEdges * sizeof(edge));
+}
+
+void ringInit(cbuf *buf, size_t slots, size_t maxEdges) {
+    buf->size = slots;
+    buf->maxEdges = maxEdges;
+    for (uint64_t i = 0; i < slots; i++) {
+        ringSlot(buf, i)->sequence = i;
+    }
+    buf->writePos = 0;
+    buf->readPos = 0;
+}
+
+/**
+ * @brief Claim consecutive positions in the ring, sleeping while the ring is full.
+ *
+ * @param buf the shared buffer
+ * @param stored the number of positions to claim, at most the size of the ring
+ * @param pos where to store the first claimed position
+ * @return 0 if claimed, -1 if the buffer is flagged for termination or interrupted
+ */
+static int ringClaim(cbuf *buf, size_t stored, uint64_t *pos) {
+    *pos = __atomic_load_n(&buf->writePos, __ATOMIC_RELAXED);
+    for (;;) {
+        if (__atomic_load_n(&buf->terminate, __ATOMIC_RELAXED)) {
+            errno = ECANCELED;
+            return -1;
+        }
+
+        // The supervisor frees the slots in order, so if the last one is free all of them are
+        uint64_t last = *pos + stored - 1;
+        slot *s = ringSlot(buf, last);
+        uint64_t sequence = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+        int64_t difference = (int64_t) (sequence - last);
+
+        if (difference == 0) {
+            // on failure pos gets updated to the current writePos
+            if (__atomic_compare_exchange_n(&buf->writePos, pos, *pos + stored, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return 0;
+            }
+        } else if (difference < 0) {
+            // the supervisor has not read this slot yet, the ring is full
+            if (ringSleep(buf, &s->sequence, sequence, &buf->freeFutex, &buf->freeWaiters) < 0) {
+                return -1;
+            }
+            *pos = __atomic_load_n(&buf->writePos, __ATOMIC_RELAXED);
+        } else {
+            // another generator claimed this position in the meantime
+            *pos = __atomic_load_n(&buf->writePos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+int ringWrite(cbuf *buf, const edge_list candidates[], size_t stored, long generated) {
+    if (stored > 0) {
+        uint64_t pos;
+        if (ringClaim(buf, stored, &pos) < 0) {
+            return -1;
+        }
+        for (size_t i = 0; i < stored; i++) {
+            slot *s = ringSlot(buf, pos + i);
+            s->stored = candidates[i].stored;
+            memcpy(s->list, candidates[i].list, sizeof(edge) * candidates[i].stored);
+            __atomic_store_n(&s->sequence, pos + i + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    long total = __atomic_add_fetch(&buf->numberOfSolutions, generated, __ATOMIC_SEQ_CST);
+    if (buf->maxSolutions > 0 && total >= buf->maxSolutions && total - generated < buf->maxSolutions) {
+        // this batch reached the limit, nobody has to generate anything anymore
+        ringTerminate(buf);
+    } else if (stored > 0) {
+        ringWake(&buf->usedFutex, &buf->usedWaiters, 1);
+    }
+    return 0;
+}
+
+size_t ringRead(cbuf *buf, edge_list candidates[], size_t max) {
+    uint64_t pos = buf->readPos;
+    for (;;) {
+        if (__atomic_load_n(&ringSlot(buf, pos)->sequence, __ATOMIC_ACQUIRE) == pos + 1) {
+            break;
+        }
+        // the ring is empty, or the generator that claimed this slot has not finished writing it yet
+        if (__atomic_load_n(&buf->terminate, __ATOMIC_SEQ_CST)) {
+            errno = ECANCELED;
+            return 0;
+        }
+        if (ringSleep(buf, &ringSlot(buf, pos)->sequence, pos, &buf->usedFutex, &buf->usedWaiters) < 0) {
+            return 0;
+        }
+    }
+
+    size_t stored = 0;
+    while (stored < max && __atomic_load_n(&ringSlot(buf, pos + stored)->sequence, __ATOMIC_ACQUIRE) == pos + stored + 1) {
+        slot *s = ringSlot(buf, pos + stored);
+        candidates[stored].list = s->list;
+        candidates[stored].stored = s->stored;
+        stored++;
+    }
+    return stored;
+}
+
+void ringRelease(cbuf *buf, size_t stored) {
+    uint64_t pos = buf->readPos;
+    for (size_t i = 0; i < stored; i++) {
+        __atomic_store_n(&ringSlot(buf, pos + i)->sequence, pos + i + buf->size, __ATOMIC_RELEASE);
+    }
+    buf->readPos = pos + stored;
+    // generators may be waiting for different slots, so all of them have to check again
+    ringWake(&buf->freeFutex, &buf->freeWaiters, INT_MAX);
+}
+
+void ringTerminate(cbuf *buf) {
+    __atomic_store_n(&buf->terminate, 1, __ATOMIC_SEQ_CST);
+    futexWake(&buf->usedFutex, INT_MAX);
+    futexWake(&buf->freeFutex, INT_MAX);
+}
@@ -13,9 +13,7 @@
 
 static int shmFd = -1;
 static cbuf *buf = NULL;
-static sem_t *semUsed = NULL;
-static sem_t *semFree = NULL;
-static sem_t *semMutex = NULL;
+static size_t bufBytes = 0;
 
 static const char* PROGRAM_NAME;
 
@@ -54,7 +52,7 @@ static void ERROR_EXIT(char *message, char *error) {
  * exits the program with a failure status using the exit(EXIT_FAILURE) call.
  */
 static void USAGE() {
-    fprintf(stderr, "Usage: %s\n", PROGRAM_NAME);
+    fprintf(stderr, "Usage: %s [-n limit] [-w delay] [-s slots] [-e edges]\n", PROGRAM_NAME);
     exit(EXIT_FAILURE);
 }
 
@@ -68,28 +66,20 @@ static void USAGE() {
  * @param signal The signal number that triggered the handler.
  */
 static void handleSignal(int signal) {
-    buf->terminate = 1;
+    __atomic_store_n(&buf->terminate, 1, __ATOMIC_SEQ_CST);
 }
 
 /**
  * @brief Perform cleanup and shutdown operations.
  *
  * This function performs cleanup operations, such as setting the termination
- * flag, releasing semaphores, closing file descriptors, and unlinking shared
+ * flag, waking up waiting generators, closing file descriptors, and unlinking shared
  * memory, in preparation for program termination.
  */
 static void shutdown() {
     if (buf != NULL) {
-        buf->terminate = 1;
-
         // Stop all waiting generators from waiting
-        if (semFree != NULL) {
-            for (size_t i = 0; i < buf->numOfGenerators; i++) {
-                if (sem_post(semFree) < 0) {
-                    ERROR_MSG("Error while sem_post for free", strerror(errno));
-                }
-            }
-        }
+        ringTerminate(buf);
     }
 
     if (shmFd != -1) {
@@ -99,40 +89,9 @@ static void shutdown() {
         shmFd = -1;
     }
 
-    if (semUsed != NULL) {
-        if (sem_close(semUsed) < 0) {
-            ERROR_MSG("Error closing used", strerror(errno));
-        }
-        if (sem_unlink(SEM_USED) < 0 && errno != ENOENT) {
-            // Only print the error if it's not "No such file or directory"
-            ERROR_MSG("Error unlinking USED", strerror(errno));
-        }
-    }
-
-    if (semFree != NULL) {
-        if (sem_close(semFree) < 0) {
-            ERROR_MSG("Error closing free", strerror(errno));
-        }
-        if (sem_unlink(SEM_FREE) < 0 && errno != ENOENT) {
-            // Only print the error if it's not "No such file or directory"
-            ERROR_MSG("Error unlinking FREE", strerror(errno));
-        }
-    }
-
-    if (semMutex != NULL) {
-        if (sem_close(semMutex) < 0) {
-            ERROR_MSG("Error closing mutex", strerror(errno));
-        }
-        if (sem_unlink(SEM_MUTEX) < 0 && errno != ENOENT) {
-            // Only print the error if it's not "No such file or directory"
-            ERROR_MSG("Error unlinking MUTEX", strerror(errno));
-        }
-    }
-
     // Unmap shared memory
     if (buf != NULL) {
-        buf->terminate = 1;
-        if (munmap(buf, sizeof(*buf)) < 0) {
+        if (munmap(buf, bufBytes) < 0) {
             ERROR_MSG("Error unmapping shared memory", strerror(errno));
         }
     }
@@ -148,9 +107,13 @@ static void shutdown() {
  *
  * This function performs startup operations, such as setting a cleanup function
  * using atexit, creating shared memory, mapping shared memory, setting signal
- * handlers, initializing the buffer, and creating semaphores.
+ * handlers, and initializing the buffer.
+ *
+ * @param slots The number of slots in the ring.
+ * @param maxEdges The maximum number of edges of a solution.
+ * @param maxSolutions The maximum number of solutions to process. Use 0 for no limit.
  */
-static void startup() {
+static void startup(size_t slots, size_t maxEdges, long maxSolutions) {
     // The atexit function in C is used to register a function to be called automatically when
     // the program terminates normally. It allows you to specify a function that should be executed
     // just before the program exits.
@@ -166,13 +129,15 @@ static void startup() {
 
     // In C programming, the ftruncate function is used to resize a file to a specified length.
     // This function is typically used with file descriptors and is part of the POSIX standard.
-    if (ftruncate(shmFd, sizeof(cbuf)) < 0) {
+    bufBytes = ringBytes(slots, maxEdges);
+    if (ftruncate(shmFd, bufBytes) < 0) {
         ERROR_EXIT("Error setting size of shared memory", strerror(errno));
     }
 
     // map shared memory object
-    buf = mmap(NULL, sizeof(*buf), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    buf = mmap(NULL, bufBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
     if (buf == MAP_FAILED) {
+        buf = NULL; // keep shutdown from touching it
         ERROR_EXIT("Error mapping shared memory", strerror(errno));
     }
     if (close(shmFd) < 0) {
@@ -189,102 +154,96 @@ static void startup() {
 
     // initialize buffer
     buf->terminate = 0;
-    buf->readPos = 0;
-    buf->writePos = 0;
+    buf->unsolvable = 0;
+    buf->optimal = 0;
     buf->numOfGenerators = 0;
     buf->numberOfSolutions = 0;
-
-
-    // create semaphores
-    semUsed = sem_open(SEM_USED, O_CREAT | O_EXCL, 0600, 0);
-    if (semUsed == SEM_FAILED) {
-        ERROR_EXIT("Error creating used", strerror(errno));
-    }
-    semFree = sem_open(SEM_FREE, O_CREAT | O_EXCL, 0600, BUF_SIZE);
-    if (semFree == SEM_FAILED) {
-        ERROR_EXIT("Error creating free", strerror(errno));
-    }
-    semMutex = sem_open(SEM_MUTEX, O_CREAT | O_EXCL, 0600, 1);
-    if (semMutex == SEM_FAILED) {
-        ERROR_EXIT("Error creating mutex", strerror(errno));
-    }
+    buf->maxSolutions = maxSolutions;
+    buf->bestSolution = SIZE_MAX;
+    ringInit(buf, slots, maxEdges);
 }
 
 /**
- * @brief Wait for a semaphore and check for termination.
+ * @brief Read edge_lists from the shared buffer.
  *
- * This function waits for the `semUsed` semaphore, which signals that there is
- * data available in the shared buffer. If the semaphore wait fails, it checks
- * for the EINTR error (interrupted system call) and handles it by retrying the
- * wait. If the buffer is flagged for termination, the program exits.
+ * This function waits until generators have written slots of the ring and
+ * reads all of them at once. A signal interrupting the wait is handled by
+ * retrying it. If the buffer is flagged for termination because the maximum
+ * number of solutions is reached, a generator cannot find any solution within
+ * maxEdges or a generator found an optimal one, nothing is read, otherwise the program exits.
+ *
+ * @param candidates Where to store the read edge_lists, one per slot of the ring.
+ * Their edges stay in the ring until ringRelease.
+ * @return The number of read edge_lists, 0 if the maximum number of solutions is reached,
+ * no solution fits or the best one is optimal.
  */
-static void waitAndRead() {
-    if (sem_wait(semUsed) < 0) {
+static size_t readBuffer(edge_list candidates[]) {
+    size_t stored;
+    while ((stored = ringRead(buf, candidates, buf->size)) == 0) {
+        if (errno == ECANCELED) {
+            long maxSolutions = buf->maxSolutions;
+            if (__atomic_load_n(&buf->unsolvable, __ATOMIC_SEQ_CST) != 0 ||
+                __atomic_load_n(&buf->optimal, __ATOMIC_SEQ_CST) != 0 ||
+                (maxSolutions > 0 && __atomic_load_n(&buf->numberOfSolutions, __ATOMIC_SEQ_CST) >= maxSolutions)) {
+                return 0;
+            }
+            exit(EXIT_SUCCESS);
+        }
         if (errno != EINTR) {
-            ERROR_EXIT("Error while executing sem_wait", strerror(errno));
+            ERROR_EXIT("Error while reading the buffer", strerror(errno));
         }
     }
-    if (buf->terminate) {
-        exit(EXIT_SUCCESS);
-    }
-}
-
-/**
- * @brief Signal that a read operation is complete.
- *
- * This function signals that a read operation is complete by posting to the
- * `semFree` semaphore, indicating that there is free space in the shared buffer.
- */
-static void readSignal() {
-    if (sem_post(semFree) < 0) {
-        ERROR_EXIT("Error while sem_post", strerror(errno));
-    }
-}
-
-/**
- * @brief Read an edge_list from the shared buffer.
- *
- * This function waits for a semaphore, reads an `edge_list` from the shared
- * buffer, signals the completion of the read, and returns the read `edge_list`.
- */
-static edge_list readBuffer() {
-    waitAndRead();
-    edge_list candidate = buf->data[buf->readPos];
-    buf->readPos = (buf->readPos + 1) % BUF_SIZE;
-    readSignal();
-    return candidate;
+    return stored;
 }
 
 /**
  * @brief Process and print solutions from the shared buffer.
  *
- * This function continuously reads solutions from the shared buffer, increments
- * the count of solutions, and prints information about the best solutions found.
- * The function terminates when the buffer is flagged for termination or the
+ * This function continuously reads solutions from the shared buffer and prints
+ * information about the best solutions found. The generators count the permutations
+ * they evaluated themselves, including the ones they dropped because they already
+ * knew a better solution. The function terminates when the graph is acyclic or the
  * maximum number of solutions is reached.
- *
- * @param maxSolutions The maximum number of solutions to process. Use 0 for no limit.
  */
-static void solutions(long maxSolutions) {
-    edge_list solution = { .stored = SIZE_MAX };
-    while (buf->terminate == 0 && (buf->numberOfSolutions < maxSolutions || maxSolutions == 0)) {
-        edge_list candidate = readBuffer();
-        buf->numberOfSolutions++;
-        if (candidate.stored == 0) {
-            printf("The graph is acyclic!\n");
-            buf->terminate = 1;
-        } else if (candidate.stored < solution.stored) {
-            solution = candidate;
-            fprintf(stderr,"Solution with %zu edges:", solution.stored);
-            for (size_t i = 0; i < solution.stored; i++) {
-                fprintf(stderr," %ld-%ld", solution.list[i].u, solution.list[i].v);
+static void solutions() {
+    edge_list solution = { .list = malloc(sizeof(edge) * buf->maxEdges), .stored = SIZE_MAX };
+    edge_list *candidates = malloc(sizeof(edge_list) * buf->size);
+    if (solution.list == NULL || candidates == NULL) {
+        ERROR_EXIT("Error allocating memory", strerror(errno));
+    }
+
+    size_t stored;
+    while ((stored = readBuffer(candidates)) > 0) {
+        for (size_t i = 0; i < stored; i++) {
+            edge_list *candidate = &candidates[i];
+            if (candidate->stored == 0) {
+                printf("The graph is acyclic!\n");
+                free(solution.list);
+                free(candidates);
+                return;
+            } else if (candidate->stored < solution.stored) {
+                solution.stored = candidate->stored;
+                memcpy(solution.list, candidate->list, sizeof(edge) * candidate->stored);
+                // generators stop looking at permutations that are not smaller than this
+                __atomic_store_n(&buf->bestSolution, solution.stored, __ATOMIC_RELAXED);
+                fprintf(stderr,"Solution with %zu edges:", solution.stored);
+                for (size_t j = 0; j < solution.stored; j++) {
+                    fprintf(stderr," %" PRIu32 "-%" PRIu32, solution.list[j].u, solution.list[j].v);
+                }
+                fprintf(stderr, "\n");
             }
-            fprintf(stderr, "\n");
         }
+        ringRelease(buf, stored);
     }
-    if (maxSolutions <= buf->numberOfSolutions) {
+    free(candidates);
+    if (solution.stored != SIZE_MAX && __atomic_load_n(&buf->optimal, __ATOMIC_SEQ_CST) != 0) {
+        printf("The best solution removes %zu edges, no solution removes fewer.\n", solution.stored);
+    } else if (solution.stored == SIZE_MAX) {
+        printf("The graph might not be acyclic, no solution removes at most %zu edges.\n", buf->maxEdges);
+    } else {
         printf("The graph might not be acyclic, best solution removes %zu edges.\n", solution.stored);
     }
+    free(solution.list);
 }
 
 /**
@@ -298,11 +257,13 @@ int main(int argc, char *argv[]) {
 
     long nValue = 0; // Default value for n
     long wValue = 0; // Default value for w
+    long sValue = BUF_SIZE; // Default value for s
+    long eValue = MAX_EDGES; // Default value for e
 
     int opt;
     char *endptr;
 
-    while ((opt = getopt(argc, argv, "hn:w:")) != -1) {
+    while ((opt = getopt(argc, argv, "hn:w:s:e:")) != -1) {
         switch (opt) {
             case 'h':
                 USAGE();
@@ -326,18 +287,49 @@ int main(int argc, char *argv[]) {
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 's':
+                errno = 0; // Reset errno before calling strtol
+                sValue = strtol(optarg, &endptr, 10);
+
+                // Check for conversion errors
+                if (errno != 0 || *endptr != '\0' || sValue <= 0 || sValue > INT_MAX) {
+                    fprintf(stderr, "Invalid number for -s option\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'e':
+                errno = 0; // Reset errno before calling strtol
+                eValue = strtol(optarg, &endptr, 10);
+
+                // Check for conversion errors
+                if (errno != 0 || *endptr != '\0' || eValue < 0 || eValue > INT_MAX) {
+                    fprintf(stderr, "Invalid number for -e option\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
             default:
                 USAGE();
         }
     }
 
-    startup();
+    if (nValue < 0) {
+        fprintf(stderr, "Invalid number for -n option\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // every slot has room for eValue edges
+    if ((size_t) sValue > (SIZE_MAX / 2) / (sizeof(slot) + eValue * sizeof(edge))) {
+        fprintf(stderr, "Ring with %ld slots of %ld edges is too large\n", sValue, eValue);
+        exit(EXIT_FAILURE);
+    }
+
+    startup(sValue, eValue, nValue);
     if (wValue < 0)  {
         ERROR_EXIT("value of -w should be greater than or equal to 0", strerror(errno));
     }
     sleep(wValue);
 
-    solutions(nValue);
+    solutions();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
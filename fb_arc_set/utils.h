@@ -10,10 +10,12 @@
 #define FB_ARC_SET_UTILS_H
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -26,33 +28,121 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <time.h>
-#include <semaphore.h>
+#include <pthread.h>
 #include <limits.h>
 
 #define SHM_NAME "/12219400_shm"
-#define BUF_SIZE (25)
-#define SEM_FREE "/12219400_free"
-#define SEM_USED "/12219400_used"
-#define SEM_MUTEX "/12219400_mutex"
+// default number of slots in the ring, of candidates a generator evaluates per batch
+// and of edges a solution may remove
+#define BUF_SIZE (1024)
+#define BATCH_SIZE (64)
+#define MAX_EDGES (64)
+// strongly connected components with at most this many vertices are solved exactly
+#define EXACT_VERTICES (16)
 
 typedef struct {
-    long u;
-    long v;
+    uint32_t u;
+    uint32_t v;
 } edge;
 
 typedef struct{
-    edge list[8];
+    edge *list;
     size_t stored;
 } edge_list;
 
 typedef struct {
-    edge_list data[BUF_SIZE];
-    unsigned int readPos;
-    unsigned int writePos;
+    uint64_t sequence;
+    size_t stored;
+    edge list[];
+} slot;
+
+typedef struct {
+    size_t size;
+    // capacity of the edge list of every slot
+    size_t maxEdges;
+    uint64_t readPos;
+    uint64_t writePos;
+    // futex words, bumped whenever a slot gets used or freed while somebody sleeps
+    unsigned int usedFutex;
+    unsigned int usedWaiters;
+    unsigned int freeFutex;
+    unsigned int freeWaiters;
     unsigned int terminate;
+    // set by a generator whose graph needs more than maxEdges edges removed in every solution
+    unsigned int unsolvable;
+    // set by a generator that solved its whole graph exactly, nothing better can follow
+    unsigned int optimal;
     unsigned int numberOfGenerators;
     int numOfGenerators;
+    // permutations evaluated by all generators, including the ones they dropped themselves
     long numberOfSolutions;
+    long maxSolutions;
+    // number of edges of the best solution the supervisor has seen so far
+    size_t bestSolution;
+    // the slots, each one followed by room for maxEdges edges
+    uint64_t data[];
 } cbuf;
 
+/**
+ * @brief Get the size of the shared memory for a ring.
+ *
+ * @param slots the number of slots in the ring
+ * @param maxEdges the capacity of the edge list of every slot
+ * @return the size in bytes
+ */
+size_t ringBytes(size_t slots, size_t maxEdges);
+
+/**
+ * @brief Initialise the sequence numbers of the ring, done once by the supervisor.
+ *
+ * @param buf the shared buffer
+ * @param slots the number of slots in the ring
+ * @param maxEdges the capacity of the edge list of every slot
+ */
+void ringInit(cbuf *buf, size_t slots, size_t maxEdges);
+
+/**
+ * @brief Write a batch of candidates into the ring, sleeping while the ring is full.
+ *
+ * The whole batch is claimed at once and the supervisor is woken up at most once.
+ * Once the evaluated permutations of all generators reach the limit of the
+ * supervisor, the buffer gets flagged for termination.
+ *
+ * @param buf the shared buffer
+ * @param candidates the candidates to write, with at most maxEdges edges each
+ * @param stored the number of candidates to write, at most the size of the ring
+ * @param generated the number of permutations evaluated for this batch
+ * @return 0 if written, -1 with errno set to ECANCELED if the supervisor terminates
+ * or to EINTR if interrupted by a signal
+ */
+int ringWrite(cbuf *buf, const edge_list candidates[], size_t stored, long generated);
+
+/**
+ * @brief Read every candidate the generators have finished writing, sleeping while the ring is empty.
+ *
+ * The edge lists of the candidates point into the ring, they stay valid until ringRelease.
+ *
+ * @param buf the shared buffer
+ * @param candidates where to store the candidates
+ * @param max the maximum number of candidates to read
+ * @return the number of candidates read, 0 with errno set to ECANCELED if the
+ * buffer is flagged for termination and empty or to EINTR if interrupted by a signal
+ */
+size_t ringRead(cbuf *buf, edge_list candidates[], size_t max);
+
+/**
+ * @brief Hand the slots of the last ringRead back to the generators.
+ *
+ * @param buf the shared buffer
+ * @param stored the number of candidates returned by ringRead
+ */
+void ringRelease(cbuf *buf, size_t stored);
+
+/**
+ * @brief Flag the buffer for termination and wake up every sleeping process.
+ *
+ * @param buf the shared buffer
+ */
+void ringTerminate(cbuf *buf);
+
 #endif //FB_ARC_SET_UTILS_H